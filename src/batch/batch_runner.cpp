@@ -0,0 +1,366 @@
+#include "batch/batch_runner.h"
+
+#include "batch/work_stealing_pool.h"
+#include "circuit/circuit.h"
+#include "circuit/interpreter/interpreter.h"
+#include "circuit/interpreter/quantity.h"
+#include "circuit/scalar.h"
+#include "circuit/util.h"
+
+#include <charconv>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+BatchRunner::BatchRunner(scalar timestep, scalar default_duration, const fs::path &tables_path, size_t num_threads) :
+	timestep(timestep),
+	default_duration(default_duration),
+	batch_path(tables_path / ("batch-" + make_timestamp())),
+	num_threads(num_threads),
+	adaptive(false),
+	method(IntegrationMethod::BackwardEuler),
+	oversampling(1),
+	operating_point(false),
+	pss_period(0.0),
+	table_chunk_size(0),
+	table_format(TableFormat::Csv) {
+}
+
+void BatchRunner::set_start_checkpoint(const fs::path &path) {
+	start_checkpoint.clear();
+	if (path.empty()) return;
+
+	std::ifstream f(path, std::ios::binary);
+	if (!f) throw std::runtime_error("Cannot open checkpoint file: " + path.string());
+
+	std::ostringstream bytes;
+	bytes << f.rdbuf();
+	start_checkpoint = std::move(bytes).str();
+}
+
+void BatchRunner::add_job(Job job) {
+	if (job.duration <= 0.0) job.duration = default_duration;
+	if (job.duration <= 0.0) {
+		throw std::invalid_argument(std::format("The duration of run {} must be positive.", job.run_name));
+	}
+
+	jobs.push_back(std::move(job));
+}
+
+void BatchRunner::add_run(const fs::path &circuit_path, scalar duration) {
+	add_job(Job{
+		.circuit_path = circuit_path,
+		.duration = duration,
+		.part_name = "",
+		.quantity = Quantity::None,
+		.value = 0.0,
+		.run_name = std::format("{:04}-{}", jobs.size(), circuit_path.stem().string()),
+		.sweep_id = no_sweep,
+	});
+}
+
+void BatchRunner::add_sweep(const fs::path &circuit_path, const std::string &part_name, Quantity quantity,
+	scalar from, scalar to, size_t points, bool logarithmic, scalar duration) {
+	if (points == 0) {
+		throw std::invalid_argument("A sweep needs at least one point.");
+	}
+	if (logarithmic && (from <= 0.0 || to <= 0.0)) {
+		throw std::invalid_argument("A logarithmic sweep needs positive bounds.");
+	}
+
+	const size_t sweep_id = sweeps.size();
+	sweeps.push_back(std::make_unique<Sweep>());
+
+	for (size_t i = 0; i < points; ++i) {
+		scalar t = points == 1 ? 0.0 : static_cast<scalar>(i) / static_cast<scalar>(points - 1);
+		scalar value = logarithmic ? from * std::pow(to / from, t) : from + (to - from) * t;
+
+		add_job(Job{
+			.circuit_path = circuit_path,
+			.duration = duration,
+			.part_name = part_name,
+			.quantity = quantity,
+			.value = value,
+			.run_name = std::format("{:04}-{}-{}={:.6g}{}", jobs.size(), circuit_path.stem().string(), part_name, value, quantity_to_unit(quantity)),
+			.sweep_id = sweep_id,
+		});
+	}
+}
+
+
+static std::string_view trim(std::string_view s) {
+	while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+	while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+	return s;
+}
+
+void BatchRunner::execute_line(std::string_view line, size_t line_idx, const fs::path &base_dir) {
+	if (auto comment = line.find("//"); comment != std::string_view::npos) {
+		line = line.substr(0, comment);
+	}
+	line = trim(line);
+	if (line.empty()) return;
+
+	std::vector<std::string_view> tokens;
+	for (auto rest = line; !(rest = trim(rest)).empty();) {
+		size_t end = 0;
+		while (end < rest.size() && !std::isspace(static_cast<unsigned char>(rest[end]))) ++end;
+		tokens.push_back(rest.substr(0, end));
+		rest.remove_prefix(end);
+	}
+
+	auto parse_typed = [&](std::string_view token, Quantity expected, std::string_view what) {
+		auto [quantity, value] = Interpreter::parse_value(token, std::format("on line {}", line_idx));
+		if (expected != Quantity::Unknown && quantity != expected) {
+			throw ParseError(std::format("Value error on line {}: The {} has to be a {} value, got value of type '{}'.",
+				line_idx, what, quantity_to_string(expected), quantity_to_string(quantity)));
+		}
+		return std::pair{ quantity, value };
+	};
+
+	auto circuit_path = [&](std::string_view token) {
+		fs::path path(token);
+		return path.is_relative() ? base_dir / path : path;
+	};
+
+	// both kinds of lines may end with 'for <duration>'
+	scalar duration = 0.0;
+	if (tokens.size() >= 2 && tokens[tokens.size() - 2] == "for") {
+		duration = parse_typed(tokens.back(), Quantity::Time, "duration").second;
+		tokens.resize(tokens.size() - 2);
+	}
+
+	if (tokens[0] == "run") {
+		// run <path> [for <duration>]
+		if (tokens.size() != 2) {
+			throw ParseError(std::format("Syntax error on line {}: Expected 'run <path> [for <duration>]'.", line_idx));
+		}
+
+		add_run(circuit_path(tokens[1]), duration);
+	}
+	else if (tokens[0] == "sweep") {
+		// sweep <path> <part> from <value> to <value> points <n> [log] [for <duration>]
+		bool logarithmic = tokens.size() == 10 && tokens[9] == "log";
+		if (logarithmic) tokens.pop_back();
+
+		if (tokens.size() != 9 || tokens[3] != "from" || tokens[5] != "to" || tokens[7] != "points") {
+			throw ParseError(std::format("Syntax error on line {}: Expected 'sweep <path> <part> from <value> to <value> points <n> [log] [for <duration>]'.", line_idx));
+		}
+
+		auto [quantity, from] = parse_typed(tokens[4], Quantity::Unknown, "sweep start");
+		scalar to = parse_typed(tokens[6], quantity, "sweep end").second;
+
+		size_t points = 0;
+		auto [ptr, ec] = std::from_chars(tokens[8].data(), tokens[8].data() + tokens[8].size(), points);
+		if (ec != std::errc() || ptr != tokens[8].data() + tokens[8].size() || points == 0) {
+			throw ParseError(std::format("Value error on line {}: The number of points has to be a positive integer, got '{}'.", line_idx, tokens[8]));
+		}
+
+		try {
+			add_sweep(circuit_path(tokens[1]), std::string(tokens[2]), quantity, from, to, points, logarithmic, duration);
+		}
+		catch (const std::invalid_argument &e) {
+			throw ParseError(std::format("Value error on line {}: {}", line_idx, e.what()));
+		}
+	}
+	else {
+		throw ParseError(std::format("Syntax error on line {}: Expected 'run' or 'sweep', got '{}'.", line_idx, tokens[0]));
+	}
+}
+
+void BatchRunner::load_manifest(const fs::path &manifest_path) {
+	std::cout << "Loading batch " << manifest_path << std::endl;
+
+	std::ifstream f(manifest_path);
+	if (!f) {
+		throw std::runtime_error("Cannot open batch file: " + manifest_path.string());
+	}
+
+	std::string line;
+	size_t line_idx = 0;
+	while (std::getline(f, line)) {
+		execute_line(line, ++line_idx, manifest_path.parent_path());
+	}
+
+	std::cout << "Loaded batch with " << jobs.size() << " runs" << std::endl;
+}
+
+
+BatchRunner::Result BatchRunner::run_job(const Job &job, std::unique_ptr<Circuit> &circuit) {
+	auto start = std::chrono::steady_clock::now();
+	Result result{ .steps = 0, .ok = true, .message = "", .wall_seconds = 0.0, .analyses = 0 };
+
+	try {
+		const fs::path run_path = batch_path / job.run_name;
+
+		if (circuit) {
+			// the same sweep ran on this worker before, the parsed and prepared circuit is just reset,
+			// a new one is prepared by set_lu_plan or the run, the run analyzes it only without the plan of the sweep
+			circuit->reset();
+			circuit->set_scope_export_path(run_path);
+		}
+		else {
+			circuit = std::make_unique<Circuit>(timestep, run_path);
+			circuit->set_verbose(false);
+			circuit->load_circuit(job.circuit_path);
+			circuit->set_adaptive(adaptive, adaptive_settings);
+			circuit->set_integration_method(method);
+			circuit->set_oversampling(oversampling);
+			circuit->set_start_from_operating_point(operating_point);
+			circuit->set_scope_decimation(scope_decimation);
+			circuit->set_table_streaming(table_chunk_size);
+			circuit->set_table_format(table_format);
+		}
+
+		if (!job.part_name.empty()) {
+			if (!circuit->get_part(job.part_name).set_parameter(job.quantity, job.value)) {
+				throw std::runtime_error(std::format("Part {} has no {} parameter.", job.part_name, quantity_to_string(job.quantity)));
+			}
+		}
+
+		// the checkpoint brings its own LU plan, the shared plan of the sweep is not needed then
+		if (!start_checkpoint.empty()) {
+			std::istringstream checkpoint(start_checkpoint);
+			circuit->load_checkpoint(checkpoint);
+		}
+
+		Sweep *sweep = job.sweep_id == no_sweep ? nullptr : sweeps[job.sweep_id].get();
+		if (sweep && !circuit->get_lu_plan()) {
+			std::lock_guard lock(sweep->mutex);
+			if (sweep->plan) circuit->set_lu_plan(sweep->plan);
+		}
+
+		if (pss_period > 0.0 && !circuit->find_periodic_steady_state(pss_period)) {
+			throw std::runtime_error("The periodic steady state did not converge.");
+		}
+
+		const size_t analyses_before = circuit->get_analysis_count();
+		const size_t steps_before = circuit->get_step();
+		const size_t num_steps = static_cast<size_t>(job.duration / timestep);
+		circuit->run_for_steps(num_steps);
+		result.steps = circuit->get_step() - steps_before;
+		result.analyses = circuit->get_analysis_count() - analyses_before;
+
+		if (sweep) {
+			std::lock_guard lock(sweep->mutex);
+			if (!sweep->plan) sweep->plan = circuit->get_lu_plan();
+		}
+
+		// the run stops early on a singular matrix
+		if (result.steps != num_steps) {
+			result.ok = false;
+			result.message = std::format("Singular matrix encountered at step {}.", result.steps);
+		}
+
+		// the runs are parallel already
+		circuit->export_tables(1);
+	}
+	catch (const std::exception &e) {
+		result.ok = false;
+		result.message = e.what();
+		// the state of the circuit is unknown, the next point loads it again
+		circuit.reset();
+	}
+
+	result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+size_t BatchRunner::run() {
+	if (jobs.empty()) {
+		throw std::runtime_error("Error: Empty batch, not running.");
+	}
+
+	fs::create_directories(batch_path);
+	results.assign(jobs.size(), Result{});
+
+	WorkStealingPool pool(num_threads);
+
+	std::cout << "Running " << jobs.size() << " runs on " << pool.thread_count() << " threads into " << batch_path << std::endl;
+
+	// worker_circuits[worker][sweep] is the circuit the worker keeps for the points of the sweep
+	std::vector<std::vector<std::unique_ptr<Circuit>>> worker_circuits(pool.thread_count());
+	for (auto &circuits : worker_circuits) {
+		circuits.resize(sweeps.size());
+	}
+
+	std::mutex print_mutex;
+	size_t finished = 0;
+	size_t failed = 0;
+
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		pool.submit([&, i] {
+			std::unique_ptr<Circuit> single;
+			auto &circuit = jobs[i].sweep_id == no_sweep ? single : worker_circuits[WorkStealingPool::current_worker_id()][jobs[i].sweep_id];
+
+			Result result = run_job(jobs[i], circuit);
+
+			std::lock_guard lock(print_mutex);
+			++finished;
+			if (!result.ok) ++failed;
+
+			std::cout << std::format("[{}/{}] {} {} ({:.3f}s)", finished, jobs.size(), jobs[i].run_name, result.ok ? "ok" : "failed", result.wall_seconds);
+			if (!result.ok) std::cout << ": " << result.message;
+			std::cout << std::endl;
+
+			results[i] = std::move(result);
+		});
+	}
+
+	pool.wait();
+
+	write_summary();
+
+	std::cout << "Finished " << jobs.size() - failed << " of " << jobs.size() << " runs, summary in " << batch_path / "summary.csv" << std::endl;
+	return failed;
+}
+
+
+// quotes a csv field when it contains a separator, a quote or a line break
+static std::string csv_field(const std::string &s) {
+	if (s.find_first_of(",\"\n") == std::string::npos) return s;
+
+	std::string quoted = "\"";
+	for (char c : s) {
+		if (c == '"') quoted += '"';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+void BatchRunner::write_summary() const {
+	fs::path filepath = batch_path / "summary.csv";
+	std::ofstream file(filepath);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open output file: " + filepath.string());
+	}
+
+	file << "run,circuit,part,value,duration,steps,analyses,status,wall_seconds,message\n";
+
+	for (size_t i = 0; i < jobs.size() && i < results.size(); ++i) {
+		const Job &job = jobs[i];
+		const Result &result = results[i];
+
+		file << csv_field(job.run_name) << ","
+			<< csv_field(job.circuit_path.string()) << ","
+			<< csv_field(job.part_name) << ",";
+		if (!job.part_name.empty()) file << job.value;
+		file << "," << job.duration << ","
+			<< result.steps << ","
+			<< result.analyses << ","
+			<< (result.ok ? "ok" : "failed") << ","
+			<< result.wall_seconds << ","
+			<< csv_field(result.message) << "\n";
+	}
+}
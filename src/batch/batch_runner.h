@@ -0,0 +1,125 @@
+#pragma once
+
+#include "circuit/circuit.h"
+#include "circuit/integration.h"
+#include "circuit/interpreter/quantity.h"
+#include "circuit/scalar.h"
+#include "circuit/scope.h"
+#include "io/table_file.h"
+#include "lingebra/lu.h"
+
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// Runs many independent simulations, the circuits of a manifest and the points of its parameter sweeps,
+// in parallel on a work-stealing pool. Every run builds its own Circuit on the worker that picked it up
+// and exports its scopes into its own directory, the batch directory gets a summary.csv of all runs.
+// The points of a sweep share the structural work: a worker loads the circuit once and only resets it
+// for its next point, and all points start from the LU plan (pivot order and pattern) of the first one.
+class BatchRunner {
+public:
+	static constexpr size_t no_sweep = std::numeric_limits<size_t>::max();
+
+	struct Job {
+		fs::path circuit_path;
+		scalar duration;
+
+		// empty when the circuit runs as it is
+		std::string part_name;
+		Quantity quantity;
+		scalar value;
+
+		std::string run_name;
+		size_t sweep_id;
+	};
+
+	struct Result {
+		size_t steps;
+		bool ok;
+		std::string message;
+		double wall_seconds;
+		// number of LU analyses the run needed, 0 when it reused a plan
+		size_t analyses;
+	};
+
+private:
+	struct Sweep {
+		std::mutex mutex;
+		std::shared_ptr<const lingebra::LUPlan> plan;
+	};
+
+	std::vector<Job> jobs;
+	std::vector<Result> results;
+	std::vector<std::unique_ptr<Sweep>> sweeps;
+
+	scalar timestep;
+	scalar default_duration;
+	fs::path batch_path;
+	size_t num_threads;
+
+	bool adaptive;
+	AdaptiveSettings adaptive_settings;
+	IntegrationMethod method;
+	size_t oversampling;
+	bool operating_point;
+	scalar pss_period;
+	Scope::Decimation scope_decimation;
+	size_t table_chunk_size;
+	TableFormat table_format;
+	// the bytes of the checkpoint every run starts from, empty when they start from zero
+	std::string start_checkpoint;
+
+	void add_job(Job job);
+	// circuit is the circuit the worker kept from the previous point of the same sweep, or nullptr
+	Result run_job(const Job &job, std::unique_ptr<Circuit> &circuit);
+
+	void execute_line(std::string_view line, size_t line_idx, const fs::path &base_dir);
+
+public:
+	// the runs go into tables_path/batch-<timestamp>/, num_threads = 0 uses all hardware threads
+	BatchRunner(scalar timestep, scalar default_duration, const fs::path &tables_path = "./", size_t num_threads = 0);
+
+	// sets the stepping of all runs
+	inline void set_adaptive(bool enabled, const AdaptiveSettings &settings = {}) { adaptive = enabled; adaptive_settings = settings; }
+	inline void set_integration_method(IntegrationMethod m) { method = m; }
+	inline void set_oversampling(size_t factor) { oversampling = factor; }
+	inline void set_start_from_operating_point(bool enabled) { operating_point = enabled; }
+	// the scopes without their own decimation
+	inline void set_scope_decimation(const Scope::Decimation &decimation) { scope_decimation = decimation; }
+	// the runs write their scope tables while running, see Circuit::set_table_streaming
+	inline void set_table_streaming(size_t chunk_size) { table_chunk_size = chunk_size; }
+	inline void set_table_format(TableFormat format) { table_format = format; }
+	// every run starts from the periodic steady state of the period, 0 turns it off
+	inline void set_periodic_steady_state(scalar period) { pss_period = period; }
+	// every run starts from the state of the checkpoint, e.g. a warmed-up circuit for the variants of a sweep,
+	// an empty path turns it off. The file is read once, each run loads the state from memory.
+	void set_start_checkpoint(const fs::path &path);
+
+	// a single run of a circuit, duration = 0 uses the default duration
+	void add_run(const fs::path &circuit_path, scalar duration = 0.0);
+
+	// points runs of a circuit with the parameter of the part set to values from from to to,
+	// spaced evenly or logarithmically, duration = 0 uses the default duration
+	void add_sweep(const fs::path &circuit_path, const std::string &part_name, Quantity quantity,
+		scalar from, scalar to, size_t points, bool logarithmic, scalar duration = 0.0);
+
+	// loads a batch manifest, see the readme for its syntax, the circuit paths are relative to the manifest
+	void load_manifest(const fs::path &manifest_path);
+
+	// runs all jobs and writes the summary, returns the number of failed runs
+	size_t run();
+
+	void write_summary() const;
+
+	inline size_t job_count() const noexcept { return jobs.size(); }
+	inline const fs::path &get_batch_path() const noexcept { return batch_path; }
+};
@@ -0,0 +1,139 @@
+#include "batch/work_stealing_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+// lets submit() find the deque of the calling worker
+static thread_local const WorkStealingPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+
+WorkStealingPool::WorkStealingPool(size_t num_threads) :
+	queued(0),
+	unfinished(0),
+	next_queue(0),
+	stopping(false),
+	first_error(nullptr) {
+	if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (size_t i = 0; i < num_threads; ++i) {
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (size_t i = 0; i < num_threads; ++i) {
+		workers.emplace_back([this, i] { worker_loop(i); });
+	}
+}
+
+WorkStealingPool::~WorkStealingPool() noexcept {
+	{
+		std::lock_guard lock(state_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	// the workers finish the remaining tasks before they exit
+	workers.clear();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+	size_t queue_id;
+	{
+		std::lock_guard lock(state_mutex);
+		queue_id = current_pool == this ? current_worker : next_queue++ % queues.size();
+
+		// counted before the push, a worker woken too early just retries
+		++queued;
+		++unfinished;
+	}
+
+	{
+		std::lock_guard lock(queues[queue_id]->mutex);
+		queues[queue_id]->tasks.push_back(std::move(task));
+	}
+
+	wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+	std::unique_lock lock(state_mutex);
+	done.wait(lock, [this] { return unfinished == 0; });
+
+	if (first_error) {
+		std::rethrow_exception(std::exchange(first_error, nullptr));
+	}
+}
+
+size_t WorkStealingPool::current_worker_id() noexcept {
+	return current_worker;
+}
+
+bool WorkStealingPool::try_take(size_t worker_id, std::function<void()> &task) {
+	// own deque from the back, the most recently submitted task
+	{
+		WorkerQueue &own = *queues[worker_id];
+		std::lock_guard lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// steal from the front of the others, starting at the neighbour so the victims are spread out
+	for (size_t k = 1; k < queues.size(); ++k) {
+		WorkerQueue &victim = *queues[(worker_id + k) % queues.size()];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void WorkStealingPool::worker_loop(size_t worker_id) {
+	current_pool = this;
+	current_worker = worker_id;
+
+	while (true) {
+		{
+			std::unique_lock lock(state_mutex);
+			wake.wait(lock, [this] { return queued > 0 || stopping; });
+			if (queued == 0) return;
+		}
+
+		std::function<void()> task;
+		if (!try_take(worker_id, task)) {
+			// the task was counted but not pushed yet, or another worker was faster
+			std::this_thread::yield();
+			continue;
+		}
+
+		{
+			std::lock_guard lock(state_mutex);
+			--queued;
+		}
+
+		try {
+			task();
+		}
+		catch (...) {
+			std::lock_guard lock(state_mutex);
+			if (!first_error) first_error = std::current_exception();
+		}
+
+		{
+			std::lock_guard lock(state_mutex);
+			if (--unfinished == 0) done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Thread pool with one task deque per worker. A worker takes the newest task from its own deque
+// and when it runs dry it steals the oldest task from the other deques, so long and short tasks
+// even out over the workers without a single shared queue everyone contends on.
+class WorkStealingPool {
+private:
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+	// guards the counters below, the workers sleep on wake and wait() sleeps on done
+	std::mutex state_mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	size_t queued;      // submitted and not yet taken by a worker
+	size_t unfinished;  // submitted and not yet finished
+	size_t next_queue;  // round robin over the queues for tasks submitted from outside the pool
+	bool stopping;
+
+	std::exception_ptr first_error;
+
+	// declared last so the workers are joined before the queues are destroyed
+	std::vector<std::jthread> workers;
+
+	bool try_take(size_t worker_id, std::function<void()> &task);
+	void worker_loop(size_t worker_id);
+
+public:
+	// num_threads = 0 uses all hardware threads
+	explicit WorkStealingPool(size_t num_threads = 0);
+	~WorkStealingPool() noexcept;
+
+	WorkStealingPool(const WorkStealingPool &) = delete;
+	WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+	// tasks submitted from a worker go to its own deque, the others are distributed round robin
+	void submit(std::function<void()> task);
+
+	// blocks until all submitted tasks finished, rethrows the first exception thrown by a task
+	void wait();
+
+	inline size_t thread_count() const noexcept { return workers.size(); }
+
+	// index of the worker running the calling task, in range 0 .. thread_count() - 1
+	static size_t current_worker_id() noexcept;
+};
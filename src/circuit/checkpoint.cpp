@@ -0,0 +1,105 @@
+#include "circuit/checkpoint.h"
+
+#include "circuit/scalar.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+void CheckpointWriter::write_size(size_t value) {
+	const uint64_t v = value;
+	out.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void CheckpointWriter::write_scalar(scalar value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void CheckpointWriter::write_double(double value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void CheckpointWriter::write_string(std::string_view value) {
+	write_size(value.size());
+	out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void CheckpointWriter::write_scalars(std::span<const scalar> values) {
+	write_size(values.size());
+	out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+}
+
+void CheckpointWriter::write_sizes(std::span<const size_t> values) {
+	write_size(values.size());
+	for (size_t value : values) write_size(value);
+}
+
+void CheckpointWriter::write_doubles(std::span<const double> values) {
+	write_size(values.size());
+	out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+}
+
+
+void CheckpointReader::read_bytes(void *data, size_t size) {
+	if (!in.read(static_cast<char *>(data), static_cast<std::streamsize>(size))) {
+		throw std::runtime_error("The checkpoint is truncated.");
+	}
+}
+
+size_t CheckpointReader::read_size() {
+	uint64_t v;
+	read_bytes(&v, sizeof(v));
+	return static_cast<size_t>(v);
+}
+
+scalar CheckpointReader::read_scalar() {
+	scalar value;
+	read_bytes(&value, sizeof(value));
+	return value;
+}
+
+double CheckpointReader::read_double() {
+	double value;
+	read_bytes(&value, sizeof(value));
+	return value;
+}
+
+std::string CheckpointReader::read_string() {
+	std::string value(read_size(), '\0');
+	read_bytes(value.data(), value.size());
+	return value;
+}
+
+std::vector<scalar> CheckpointReader::read_scalars() {
+	std::vector<scalar> values(read_size());
+	read_bytes(values.data(), values.size() * sizeof(scalar));
+	return values;
+}
+
+std::vector<size_t> CheckpointReader::read_sizes() {
+	std::vector<size_t> values(read_size());
+	for (auto &value : values) value = read_size();
+	return values;
+}
+
+void CheckpointReader::read_scalars(std::span<scalar> values) {
+	const size_t size = read_size();
+	if (size != values.size()) {
+		throw std::runtime_error(std::format("The checkpoint has {} values where {} were expected.", size, values.size()));
+	}
+	read_bytes(values.data(), values.size_bytes());
+}
+
+void CheckpointReader::read_doubles(std::span<double> values) {
+	const size_t size = read_size();
+	if (size != values.size()) {
+		throw std::runtime_error(std::format("The checkpoint has {} values where {} were expected.", size, values.size()));
+	}
+	read_bytes(values.data(), values.size_bytes());
+}
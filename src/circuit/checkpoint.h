@@ -0,0 +1,58 @@
+#pragma once
+
+#include "circuit/scalar.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// The binary stream of a checkpoint. The sizes are stored as 64 bit and the scalars and doubles as they are in memory,
+// in the byte order of the machine, so a checkpoint is read back exactly by a build with the same scalar.
+class CheckpointWriter {
+private:
+	std::ostream &out;
+
+public:
+	explicit CheckpointWriter(std::ostream &out) : out(out) {}
+
+	void write_size(size_t value);
+	void write_scalar(scalar value);
+	// the running sums of the measurements and spectra, which are double in either build
+	void write_double(double value);
+	void write_bool(bool value) { write_size(value ? 1 : 0); }
+	void write_string(std::string_view value);
+
+	// the count followed by the values
+	void write_scalars(std::span<const scalar> values);
+	void write_sizes(std::span<const size_t> values);
+	void write_doubles(std::span<const double> values);
+};
+
+// Reads what a CheckpointWriter wrote in the same order, throws std::runtime_error when the stream ends early.
+class CheckpointReader {
+private:
+	std::istream &in;
+
+	void read_bytes(void *data, size_t size);
+
+public:
+	explicit CheckpointReader(std::istream &in) : in(in) {}
+
+	size_t read_size();
+	scalar read_scalar();
+	double read_double();
+	bool read_bool() { return read_size() != 0; }
+	std::string read_string();
+
+	std::vector<scalar> read_scalars();
+	std::vector<size_t> read_sizes();
+
+	// reads a list of scalars that has to have exactly values.size() values
+	void read_scalars(std::span<scalar> values);
+	void read_doubles(std::span<double> values);
+};
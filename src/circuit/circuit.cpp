@@ -1,29 +1,64 @@
 #include "circuit/circuit.h"
 
+#include "circuit/checkpoint.h"
 #include "circuit/interpreter/interpreter.h"
+#include "circuit/measurement.h"
+#include "circuit/name_table.h"
 #include "circuit/node.h"
 #include "circuit/part.h"
 #include "circuit/parts/voltage_source.h"
 #include "circuit/pin.h"
+#include "circuit/probe.h"
 #include "circuit/scalar.h"
 #include "circuit/scope.h"
+#include "circuit/scope_writer.h"
+#include "circuit/time_axis.h"
 #include "circuit/util.h"
+#include "io/csv_writer.h"
+#include "io/plot_data.h"
+#include "io/table_file.h"
 #include "lingebra/lingebra.h"
+#include "lingebra/lu.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <complex>
+#include <exception>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
 
 
 Circuit::Circuit(scalar timestep, const fs::path &scope_export_path) :
 	timestep(timestep),
+	method(IntegrationMethod::BackwardEuler),
 	scope_export_path(scope_export_path / make_timestamp()),
+	scope_axis{ .start = 0.0, .timestep = timestep, .samples = 0 },
+	table_format(TableFormat::Csv),
+	table_chunk_size(0),
+	scope_writer(nullptr),
+	verbose(true),
+	step(0),
+	time(0.0),
+	prepared(false),
+	analysis_count(0),
+	oversampling(1),
+	start_from_operating_point(false),
+	operating_point_pending(false),
 	interpreter(nullptr) {
 	fs::create_directories(this->scope_export_path);
 	fs::create_directories(scope_export_path / "latest");
@@ -41,6 +76,17 @@ VoltageSource *Circuit::get_ground() const {
 	return ground;
 }
 
+Part *Circuit::find_part(std::string_view name) const noexcept {
+	const NameId id = names.find(name);
+	return id < parts_by_name.size() ? parts_by_name[id] : nullptr;
+}
+
+Part &Circuit::get_part(std::string_view name) {
+	Part *part = find_part(name);
+	if (part == nullptr) throw std::out_of_range(std::format("The circuit does not have part '{}'.", name));
+	return *part;
+}
+
 Node *Circuit::create_new_node() {
 	auto node = std::make_unique<Node>();
 	Node *raw = node.get();
@@ -49,6 +95,8 @@ Node *Circuit::create_new_node() {
 }
 
 void Circuit::connect(const Pin &pin_a, const Pin &pin_b) {
+	prepared = false;
+
 	if (pin_a.node == pin_b.node) {
 		if (pin_a.node == nullptr) {
 			Node *node = create_new_node();
@@ -64,7 +112,24 @@ void Circuit::connect(const Pin &pin_a, const Pin &pin_b) {
 	}
 }
 
-lingebra::Matrix<scalar> Circuit::build_matrix(const StampParams &params) const {
+void Circuit::allocate() {
+	if (parts.size() == 1) {
+		throw std::runtime_error("Error: Empty circuit, not running.");
+	}
+	for (const auto &part : parts) {
+		for (size_t i = 0; i < part->pin_count(); ++i) {
+			if (part->pin(i).node == nullptr) {
+				throw std::runtime_error(std::format("Error: Disconnected pin {}, not running.", part->pin(i).name()));
+			}
+		}
+	}
+
+	// the nodes keep their voltages when the circuit is prepared again, they are read before the solution is allocated anew
+	std::vector<scalar> voltages(nodes.size());
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		voltages[i] = nodes[i]->voltage();
+	}
+
 	// reserve rows
 	size_t num_rows = 0;
 
@@ -78,116 +143,1167 @@ lingebra::Matrix<scalar> Circuit::build_matrix(const StampParams &params) const
 		num_rows += part->num_needed_matrix_rows();
 	}
 
+	ground_pin.emplace(ground->pin());
+
+	matrix.assign(num_rows, num_rows);
+	rhs.assign(num_rows);
+	solution.assign(num_rows);
+
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		if (nodes[i]->is_ground) continue;
+		nodes[i]->solution.bind(solution.elements(), nodes[i]->node_id);
+		solution[nodes[i]->node_id] = voltages[i];
+	}
+	for (auto &part : parts) {
+		part->bind_solution(solution.elements());
+	}
+
+	lu_plan.reset();
+	matrix_structure.assign(num_rows * num_rows, 0);
+
+	// stamp once to find out how many entries the parts generate, it may change later,
+	// but the list will only grow when it does
+	StampParams params{
+		.ground = *ground_pin,
+		.timestep = timestep,
+		.timestep_inv = 1.0_s / timestep,
+		.step = step,
+		.time = time,
+		.method = method,
+		.dc = false,
+		.gmin = 0.0,
+		.source_scale = 1.0,
+	};
+	matrix_entries.clear();
+	for (const auto &part : parts) {
+		part->stamp_matrix_entries(matrix_entries, params);
+	}
+	matrix_entries.reserve(2 * matrix_entries.size());
+
+	op_previous.assign(num_rows, 0.0);
+
+	sample_values.assign(first_output_value() + outputs.size(), 0.0);
+	decimators.clear();
+	if (oversampling > 1) {
+		decimators.assign(sample_values.size(), Decimator(oversampling));
+	}
+
+	prepared = true;
+}
+
+void Circuit::prepare() {
+	allocate();
+
+	// the matrix of the first step is analyzed here, so that the step does not allocate,
+	// a singular matrix is left to the step to report
+	try {
+		factorize_matrix();
+	}
+	catch (const lingebra::singular_matrix_exception &) {
+		lu_plan.reset();
+	}
+}
+
+void Circuit::build_matrix(const StampParams &params) {
 	// [(row, column, data), ...]
-	std::vector<MatrixEntry> matrix_entries;
+	matrix_entries.clear();
 
 	for (const auto &part : parts) {
-		auto entries = part->gen_matrix_entries(params);
-		matrix_entries.insert(matrix_entries.end(), entries.begin(), entries.end());
+		part->stamp_matrix_entries(matrix_entries, params);
 	}
 
-	lingebra::Matrix<scalar> matrix(num_rows, num_rows);
+	if (params.gmin > 0.0) {
+		for (const auto &node : nodes) {
+			if (node->is_ground) continue;
+			matrix_entries.push_back({ node->node_id, node->node_id, params.gmin });
+		}
+	}
+}
 
+bool Circuit::fill_matrix() {
+	// the factorization only writes into the pattern of the plan, so just that has to be cleared
+	if (lu_plan) {
+		for (const auto &[row, col] : lu_plan->get_positions()) {
+			matrix(row, col) = 0.0;
+		}
+	}
+	else {
+		matrix.clear();
+	}
+
+	bool in_pattern = true;
 	for (const auto &[row, col, value] : matrix_entries) {
 		matrix(row, col) += value;
+		if (lu_plan && !lu_plan->contains(row, col)) in_pattern = false;
 	}
 
-	return matrix;
+	return in_pattern;
 }
 
-void Circuit::update(size_t step, scalar t) {
+void Circuit::factorize_matrix() {
+	if (fill_matrix() && lu_plan && lu_plan->factorize(matrix)) return;
+
+	// new pattern or a pivot broke down, analyze the matrix again, that allocates
+	const size_t n = matrix.n();
+	if (lu_plan) {
+		const auto &mask = lu_plan->get_mask();
+		for (size_t i = 0; i < mask.size(); ++i) matrix_structure[i] |= mask[i];
+	}
+	for (const auto &[row, col, value] : matrix_entries) {
+		matrix_structure[row * n + col] = 1;
+	}
+
+	lu_plan.reset();
+	fill_matrix();
+
+	lu_plan = std::make_shared<const lingebra::LUPlan>(lingebra::LUPlan::analyze(matrix, matrix_structure));
+	++analysis_count;
+
+	if (!lu_plan->factorize(matrix)) {
+		throw lingebra::singular_matrix_exception();
+	}
+}
+
+void Circuit::set_lu_plan(std::shared_ptr<const lingebra::LUPlan> plan) {
+	if (!prepared) allocate();
+
+	if (plan && plan->dim() != matrix.n()) {
+		throw std::invalid_argument(std::format("The LU plan is for {} rows, the circuit has {}.", plan->dim(), matrix.n()));
+	}
+
+	lu_plan = std::move(plan);
+	matrix.clear();
+}
+
+void Circuit::solve_step(const StampParams &params) {
+	// TODO: update the matrix instead of building it anew
+	build_matrix(params);
+	factorize_matrix();
+
+	rhs.clear();
+
+	const std::span<scalar> rhs_entries = rhs.elements();
+	for (auto &part : parts) {
+		part->stamp_rhs_entries(rhs_entries, params);
+	}
+
+	// the nodes and parts read the new solution in place
+	lu_plan->solve(matrix, rhs, solution);
+}
+
+void Circuit::commit_step(const StampParams &params) {
+	for (auto &part : parts) {
+		part->update(params);
+	}
+}
+
+void Circuit::update(scalar t, scalar h) {
 	StampParams params{
-		.ground = ground->pin(),
-		.timestep = timestep,
-		.timestep_inv = 1.0 / timestep,
+		.ground = *ground_pin,
+		.timestep = h,
+		.timestep_inv = 1.0_s / h,
 		.step = step,
 		.time = t,
+		.method = method,
+		.dc = false,
+		.gmin = 0.0,
+		.source_scale = 1.0,
 	};
 
-	// TODO: update the matrix instead of building it anew
-	auto matrix = build_matrix(params);
+	solve_step(params);
+	commit_step(params);
+}
 
-	std::vector<scalar> rhs(matrix.m(), 0.0);
+void Circuit::simulate_sample(bool measure_scopes) {
+	const scalar sub_timestep = timestep / static_cast<scalar>(oversampling);
+	const size_t first = measure_scopes ? 0 : first_output_value();
 
-	for (auto &part : parts) {
-		part->stamp_rhs_entries(rhs, params);
+	for (size_t j = 0; j < oversampling; ++j) {
+		const scalar t = time + static_cast<scalar>(j) * sub_timestep;
+
+		if (adaptive.enabled) {
+			advance_adaptive(t);
+
+			for (size_t i = first; i < sample_values.size(); ++i) {
+				sample_values[i] = interpolate_adaptive(i, t);
+			}
+		}
+		else {
+			update(t, sub_timestep);
+
+			if (measure_scopes) {
+				for (size_t i = 0; i < scopes.size(); ++i) {
+					sample_values[i] = scopes[i]->measure();
+				}
+				for (size_t i = 0; i < measurements.size(); ++i) {
+					sample_values[scopes.size() + i] = measurements[i].get_probe().measure();
+				}
+			}
+			for (size_t i = 0; i < outputs.size(); ++i) {
+				sample_values[first_output_value() + i] = outputs[i].probe.measure();
+			}
+		}
+
+		// the last substep completes the decimated sample, it replaces the raw value
+		if (oversampling > 1) {
+			for (size_t i = first; i < sample_values.size(); ++i) {
+				decimators[i].push(sample_values[i], sample_values[i]);
+			}
+		}
 	}
+}
 
-	lingebra::Vector<scalar> rhs_vec(rhs); // TODO: do not copy the vector, just move it insted
+bool Circuit::iterate_operating_point(scalar gmin, scalar source_scale) {
+	StampParams params{
+		.ground = *ground_pin,
+		.timestep = timestep,
+		.timestep_inv = 1.0_s / timestep,
+		.step = step,
+		.time = time,
+		.method = method,
+		.dc = true,
+		.gmin = gmin,
+		.source_scale = source_scale,
+	};
 
-	std::cout << matrix.repr() << "\n" << rhs_vec.repr() << "\n";
+	// the only nonlinear parts are the piecewise linear ones (op amps), they switch their mode in update,
+	// so the operating point is found once a solve no longer changes the solution
+	for (size_t i = 0; i < op_max_iterations; ++i) {
+		try {
+			solve_step(params);
+		}
+		catch (const lingebra::singular_matrix_exception &) {
+			return false;
+		}
+		commit_step(params);
+
+		bool converged = i > 0;
+		for (size_t j = 0; j < op_previous.size(); ++j) {
+			if (std::abs(solution[j] - op_previous[j]) > op_tolerance * (1.0 + std::abs(solution[j]))) converged = false;
+			op_previous[j] = solution[j];
+		}
 
-	lingebra::solve_gaussian_elimination(matrix, rhs_vec);
+		if (converged) return true;
+	}
 
-	for (auto &part : parts) {
-		for (size_t i = 0; i < part->num_needed_matrix_rows(); ++i) {
-			part->update_value_from_result(i, rhs_vec[part->get_first_matrix_row_id() + i]);
+	return false;
+}
+
+bool Circuit::solve_operating_point() {
+	if (!prepared) prepare();
+	operating_point_pending = false;
+
+	bool ok = iterate_operating_point(op_gmin, 1.0);
+
+	if (!ok) {
+		// gmin stepping: a large conductance to ground makes the matrix well conditioned and pulls the nodes
+		// towards 0, every smaller one starts from the state of the previous one
+		ok = true;
+		for (scalar gmin = op_gmin_start; ok && gmin > op_gmin; gmin *= 0.1) {
+			ok = iterate_operating_point(gmin, 1.0);
 		}
+		ok = ok && iterate_operating_point(op_gmin, 1.0);
 	}
-	for (auto &node : nodes) {
-		if (node->is_ground) continue;
-		node->voltage = rhs_vec[node->node_id];
+
+	if (!ok) {
+		// source stepping: ramp all sources up from 0, every step starts from the state of the previous one
+		ok = true;
+		for (size_t k = 1; ok && k <= op_source_steps; ++k) {
+			ok = iterate_operating_point(op_gmin, static_cast<scalar>(k) / static_cast<scalar>(op_source_steps));
+		}
 	}
 
-	for (auto &part : parts) {
-		part->update(params);
+	if (!ok) {
+		if (verbose) std::cout << "The dc operating point did not converge, starting from zero" << std::endl;
+
+		solution.clear();
+		for (auto &part : parts) {
+			part->reset();
+		}
+	}
+
+	// the decimated scopes and outputs have been at the operating point before the start too
+	for (size_t i = 0; i < decimators.size(); ++i) {
+		scalar value;
+		if (i < scopes.size()) value = scopes[i]->measure();
+		else if (i < first_output_value()) value = measurements[i - scopes.size()].get_probe().measure();
+		else value = outputs[i - first_output_value()].probe.measure();
+		decimators[i].reset(value);
 	}
+
+	return ok;
 }
 
-void Circuit::run_for_steps(size_t num_steps) {
-	if (parts.size() == 1) {
-		throw std::runtime_error("Error: Empty circuit, not running.");
+void Circuit::set_start_from_operating_point(bool enabled) noexcept {
+	start_from_operating_point = enabled;
+	operating_point_pending = enabled && step == 0;
+}
+
+
+size_t Circuit::state_size() const {
+	size_t size = 0;
+	for (const auto &part : parts) {
+		size += part->state_size();
 	}
+	return size;
+}
+
+void Circuit::save_state(std::span<scalar> state) const {
 	for (const auto &part : parts) {
-		for (size_t i = 0; i < part->pin_count(); ++i) {
-			if (part->pin(i).node == nullptr) {
-				throw std::runtime_error(std::format("Error: Disconnected pin {}, not running.", part->pin(i).name));
+		part->save_state(state.first(part->state_size()));
+		state = state.subspan(part->state_size());
+	}
+}
+
+void Circuit::load_state(std::span<const scalar> state) {
+	for (auto &part : parts) {
+		part->load_state(state.first(part->state_size()));
+		state = state.subspan(part->state_size());
+	}
+}
+
+bool Circuit::find_periodic_steady_state(scalar period) {
+	if (period <= 0.0) {
+		throw std::invalid_argument("The period must be positive.");
+	}
+
+	if (!prepared) prepare();
+	if (operating_point_pending) solve_operating_point();
+
+	const scalar max_timestep = timestep / static_cast<scalar>(oversampling);
+	const size_t period_steps = static_cast<size_t>(std::ceil(period / max_timestep - 1e-9));
+	const scalar h = period / static_cast<scalar>(period_steps);
+
+	const size_t n = state_size();
+	std::vector<scalar> start(n), x(n), end(n), perturbed(n), perturbed_end(n);
+	save_state(start);
+
+	// simulates one period starting in the state from, without recording, and stores the final state into to
+	auto shoot = [&](std::span<const scalar> from, std::span<scalar> to) {
+		load_state(from);
+		for (size_t j = 0; j < period_steps; ++j) {
+			update(time + static_cast<scalar>(j) * h, h);
+		}
+		save_state(to);
+	};
+
+	bool converged = false;
+	size_t iterations = 0;
+
+	try {
+		// one period first, so the histories are filled by steps of h like in the following ones
+		shoot(start, x);
+
+		lingebra::Matrix<scalar> jacobian;
+		lingebra::Vector<scalar> correction;
+
+		for (; iterations < pss_max_iterations; ++iterations) {
+			shoot(x, end);
+
+			converged = true;
+			for (size_t k = 0; k < n; ++k) {
+				if (std::abs(end[k] - x[k]) > pss_tolerance * (1.0 + std::abs(x[k]))) converged = false;
+			}
+			if (converged) {
+				x = end;
+				break;
+			}
+
+			// J = d end / d x - I, the residual end - x has to become 0
+			jacobian.assign(n, n);
+			correction.assign(n);
+
+			for (size_t k = 0; k < n; ++k) {
+				const scalar delta = 1e-6 * (1.0 + std::abs(x[k]));
+
+				perturbed = x;
+				perturbed[k] += delta;
+				shoot(perturbed, perturbed_end);
+
+				for (size_t r = 0; r < n; ++r) {
+					jacobian(r, k) = (perturbed_end[r] - end[r]) / delta - (r == k ? 1.0 : 0.0);
+				}
+			}
+
+			for (size_t r = 0; r < n; ++r) {
+				correction[r] = x[r] - end[r];
+			}
+			lingebra::solve_gaussian_elimination(jacobian, correction);
+
+			for (size_t k = 0; k < n; ++k) {
+				x[k] += correction[k];
 			}
 		}
 	}
+	catch (const lingebra::singular_matrix_exception &) {
+		converged = false;
+	}
+
+	load_state(converged ? x : start);
+
+	if (verbose) {
+		if (converged) std::cout << "Found the periodic steady state in " << iterations << " Newton iterations" << std::endl;
+		else std::cout << "The periodic steady state did not converge, starting from the previous state" << std::endl;
+	}
+
+	return converged;
+}
+
+
+void Circuit::run_ac_sweep(scalar f_start, scalar f_stop, size_t points, size_t num_threads) {
+	if (points == 0) {
+		throw std::invalid_argument("The ac sweep needs at least one point.");
+	}
+	if (f_start <= 0.0 || f_stop <= 0.0) {
+		throw std::invalid_argument("The frequencies of the ac sweep must be positive.");
+	}
 
-	// TODO: do LU decomposition
+	if (!prepared) allocate();
+	if (operating_point_pending) solve_operating_point();
 
-	std::cout << "Running for " << num_steps << " steps with frequency=" << 1.0_s / timestep << std::endl;
+	const StampParams params{
+		.ground = *ground_pin,
+		.timestep = timestep,
+		.timestep_inv = 1.0_s / timestep,
+		.step = step,
+		.time = time,
+		.method = method,
+		.dc = false,
+		.gmin = 0.0,
+		.source_scale = 1.0,
+	};
+
+	// the matrix at the angular frequency w is conductance + j w susceptance, only the parts stamp, the threads do not touch them
+	std::vector<MatrixEntry> conductance;
+	std::vector<MatrixEntry> susceptance;
+	for (const auto &part : parts) {
+		part->stamp_ac_entries(conductance, susceptance, params);
+	}
+
+	const size_t n = matrix.n();
+	std::vector<complex_scalar> excitation(n);
+	for (const auto &part : parts) {
+		part->stamp_ac_excitation(excitation);
+	}
+
+	std::vector<char> structure(n * n, 0);
+	for (const auto &[row, col, value] : conductance) structure[row * n + col] = 1;
+	for (const auto &[row, col, value] : susceptance) structure[row * n + col] = 1;
+
+	std::vector<scalar> frequencies(points);
+	for (size_t i = 0; i < points; ++i) {
+		const scalar t = points == 1 ? 0.0 : static_cast<scalar>(i) / static_cast<scalar>(points - 1);
+		frequencies[i] = f_start * std::pow(f_stop / f_start, t);
+	}
 
-	size_t step = 0;
-	scalar t = 0;
+	auto fill = [&](lingebra::Matrix<complex_scalar> &a, scalar omega) {
+		a.clear();
+		for (const auto &[row, col, value] : conductance) a(row, col) += value;
+		for (const auto &[row, col, value] : susceptance) a(row, col) += complex_scalar(0.0, omega * value);
+	};
 
+	// the pattern is the same at every frequency, the pivots are chosen in the middle of the sweep
+	lingebra::Matrix<complex_scalar> middle;
+	middle.assign(n, n);
+	fill(middle, tau * std::sqrt(f_start * f_stop));
+	std::optional<lingebra::LUPlan> shared_plan;
 	try {
-		for (; step < num_steps; ++step) {
-			update(step, t);
+		shared_plan.emplace(lingebra::LUPlan::analyze(middle, structure));
+	}
+	catch (const lingebra::singular_matrix_exception &) {
+		// every point analyzes its own matrix
+	}
+
+	if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = std::min(num_threads, points);
+
+	if (verbose) {
+		std::cout << "Running ac analysis for " << points << " frequencies from " << f_start << " Hz to " << f_stop
+			<< " Hz on " << num_threads << " threads" << std::endl;
+	}
+
+	// results[point * scopes + scope]
+	std::vector<complex_scalar> results(points * scopes.size());
+	std::atomic<size_t> next_point = 0;
+
+	auto worker = [&] {
+		lingebra::Matrix<complex_scalar> a;
+		a.assign(n, n);
+		lingebra::Vector<complex_scalar> b(n);
+		lingebra::Vector<complex_scalar> x(n);
+		std::vector<complex_scalar> solution(n);
+		std::optional<lingebra::LUPlan> own_plan;
+
+		for (size_t i; (i = next_point++) < points;) {
+			const scalar omega = tau * frequencies[i];
+			const lingebra::LUPlan *plan = shared_plan ? &*shared_plan : nullptr;
+
+			fill(a, omega);
+			if (!plan || !plan->factorize(a)) {
+				// a pivot of the shared plan is too small at this frequency
+				try {
+					fill(a, omega);
+					own_plan.emplace(lingebra::LUPlan::analyze(a, structure));
+					plan = &*own_plan;
+					if (!plan->factorize(a)) plan = nullptr;
+				}
+				catch (const lingebra::singular_matrix_exception &) {
+					plan = nullptr;
+				}
+			}
+
+			if (!plan) {
+				const scalar nan = std::numeric_limits<scalar>::quiet_NaN();
+				std::fill_n(results.begin() + i * scopes.size(), scopes.size(), complex_scalar(nan, nan));
+				continue;
+			}
+
+			for (size_t j = 0; j < n; ++j) b[j] = excitation[j];
+			plan->solve(a, b, x);
+			for (size_t j = 0; j < n; ++j) solution[j] = x[j];
 
-			for (const auto &scope : scopes) {
-				scope->record(t);
+			for (size_t s = 0; s < scopes.size(); ++s) {
+				results[i * scopes.size() + s] = scopes[s]->measure_ac(solution, omega);
 			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < num_threads; ++t) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	for (size_t i = 0; i < points; ++i) {
+		for (size_t s = 0; s < scopes.size(); ++s) {
+			scopes[s]->record_ac(frequencies[i], results[i * scopes.size() + s]);
+		}
+	}
+}
+
+
+void Circuit::set_oversampling(size_t factor) {
+	if (factor == 0) {
+		throw std::invalid_argument("The oversampling factor must be positive.");
+	}
+
+	oversampling = factor;
+	prepared = false;
+}
+
+
+void Circuit::set_adaptive(bool enabled, const AdaptiveSettings &settings) {
+	adaptive.enabled = enabled;
+	adaptive.settings = settings;
+	adaptive.started = false;
+	adaptive.prev_time = time;
+	adaptive.now_time = time;
+	adaptive.next_timestep = 0.0;
+}
+
+scalar Circuit::min_adaptive_timestep() const noexcept {
+	return adaptive.settings.min_timestep > 0.0 ? adaptive.settings.min_timestep : timestep * 1e-6;
+}
+
+scalar Circuit::max_adaptive_timestep() const noexcept {
+	return adaptive.settings.max_timestep > 0.0 ? adaptive.settings.max_timestep : timestep * 1000.0;
+}
+
+void Circuit::advance_adaptive(scalar target_time) {
+	const scalar h_min = min_adaptive_timestep();
+	const scalar h_max = max_adaptive_timestep();
+	// the first step and the steps after a breakpoint start small, the derivatives are not known there
+	const scalar h_start = std::clamp<scalar>(timestep * 1e-3_s, h_min, h_max);
 
-			t += timestep;
+	if (adaptive.next_timestep <= 0.0) adaptive.next_timestep = h_start;
+
+	while (!adaptive.started || adaptive.now_time < target_time) {
+		const scalar t = adaptive.now_time;
+		scalar h = std::clamp(adaptive.next_timestep, h_min, h_max);
+
+		// land exactly on the next breakpoint instead of stepping over it
+		scalar breakpoint = std::numeric_limits<scalar>::infinity();
+		for (const auto &part : parts) {
+			breakpoint = std::min(breakpoint, part->next_breakpoint());
+		}
+		const bool hits_breakpoint = breakpoint > t + 0.5 * h_min && breakpoint <= t + h;
+		if (hits_breakpoint) h = breakpoint - t;
+
+		StampParams params{
+			.ground = *ground_pin,
+			.timestep = h,
+			.timestep_inv = 1.0_s / h,
+			.step = step,
+			.time = t + h,
+			.method = method,
+			.dc = false,
+			.gmin = 0.0,
+			.source_scale = 1.0,
+		};
+
+		solve_step(params);
+		++adaptive.solves;
+
+		scalar error = 0.0;
+		for (const auto &part : parts) {
+			error = std::max(error, part->local_truncation_error(params, adaptive.settings.tolerance));
+		}
+
+		// the error of a method of order p grows with h^(p + 1)
+		const scalar exponent = 1.0 / static_cast<scalar>(integration_order(method) + 1);
+		const scalar factor = error > 0.0 ? std::clamp(0.9 * std::pow(error, -exponent), 0.2, 2.0) : 2.0;
+
+		if (error > 1.0 && h > h_min) {
+			// reject, the parts did not take the step as their state yet
+			++adaptive.rejections;
+			adaptive.next_timestep = std::max(h * factor, h_min);
+			continue;
+		}
+
+		commit_step(params);
+
+		adaptive.prev_time = t;
+		adaptive.now_time = t + h;
+		std::swap(adaptive.prev_values, adaptive.now_values);
+		measure_adaptive_values();
+
+		if (!adaptive.started) {
+			adaptive.prev_values = adaptive.now_values;
+			adaptive.started = true;
+		}
+
+		adaptive.next_timestep = hits_breakpoint ? h_start : h * factor;
+	}
+}
+
+void Circuit::measure_adaptive_values() {
+	adaptive.now_values.resize(first_output_value() + outputs.size());
+
+	for (size_t i = 0; i < scopes.size(); ++i) {
+		adaptive.now_values[i] = scopes[i]->measure();
+	}
+	for (size_t i = 0; i < measurements.size(); ++i) {
+		adaptive.now_values[scopes.size() + i] = measurements[i].get_probe().measure();
+	}
+	for (size_t i = 0; i < outputs.size(); ++i) {
+		adaptive.now_values[first_output_value() + i] = outputs[i].probe.measure();
+	}
+}
+
+scalar Circuit::interpolate_adaptive(size_t i, scalar t) const noexcept {
+	const scalar span = adaptive.now_time - adaptive.prev_time;
+	const scalar a = span > 0.0 ? clamp((t - adaptive.prev_time) / span, 0.0, 1.0) : 1.0;
+
+	return adaptive.prev_values[i] + a * (adaptive.now_values[i] - adaptive.prev_values[i]);
+}
+
+void Circuit::run_for_steps(size_t num_steps) {
+	if (!prepared) prepare();
+	if (operating_point_pending) solve_operating_point();
+
+	if (verbose) {
+		std::cout << "Running for " << num_steps << " steps with frequency=" << 1.0_s / timestep;
+		if (oversampling > 1) std::cout << " oversampled " << oversampling << "x";
+		std::cout << std::endl;
+	}
+
+	begin_recording(num_steps);
+
+	size_t end_step = step + num_steps;
+	size_t solves_before = adaptive.solves;
+	size_t rejections_before = adaptive.rejections;
+
+	try {
+		for (; step < end_step; ++step) {
+			simulate_sample(true);
+			record_sample();
+
+			time += timestep;
 		}
 	}
 	catch (const lingebra::singular_matrix_exception &) {
-		std::cout << "Singular matrix encountered at time=" << t << "(step=" << step << ")\n";
+		if (verbose) std::cout << "Singular matrix encountered at time=" << time << "(step=" << step << ")\n";
+	}
+
+	if (verbose && adaptive.enabled) {
+		std::cout << "Adaptive stepping: " << adaptive.solves - solves_before << " solves ("
+			<< adaptive.rejections - rejections_before << " rejected) for " << num_steps << " samples" << std::endl;
+	}
+}
+
+void Circuit::record_sample() {
+	for (size_t i = 0; i < scopes.size(); ++i) {
+		scopes[i]->record_value(sample_values[i]);
+	}
+	for (size_t i = 0; i < measurements.size(); ++i) {
+		measurements[i].add(sample_values[scopes.size() + i]);
+	}
+	++scope_axis.samples;
+}
+
+void Circuit::process_block(size_t n_frames, std::span<const std::span<const scalar>> input_buffers, std::span<const std::span<scalar>> output_buffers, bool record_scopes) {
+	if (input_buffers.size() != inputs.size() || output_buffers.size() != outputs.size()) {
+		throw std::invalid_argument(std::format("process_block expects {} input and {} output buffers, got {} and {}.", inputs.size(), outputs.size(), input_buffers.size(), output_buffers.size()));
+	}
+	for (const auto &buffer : input_buffers) {
+		if (buffer.size() < n_frames) throw std::invalid_argument("process_block input buffer is shorter than the block.");
+	}
+	for (const auto &buffer : output_buffers) {
+		if (buffer.size() < n_frames) throw std::invalid_argument("process_block output buffer is shorter than the block.");
+	}
+
+	if (!prepared) prepare();
+	if (operating_point_pending) solve_operating_point();
+
+	if (record_scopes) begin_recording(n_frames);
+
+	for (size_t frame = 0; frame < n_frames; ++frame) {
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			inputs[i].source->drive(input_buffers[i][frame]);
+		}
+
+		simulate_sample(record_scopes);
+
+		for (size_t i = 0; i < outputs.size(); ++i) {
+			output_buffers[i][frame] = sample_values[first_output_value() + i];
+		}
+
+		if (record_scopes) record_sample();
+
+		++step;
+		time += timestep;
+	}
+}
+
+void Circuit::reset() {
+	step = 0;
+	time = 0.0;
+
+	solution.clear();
+	for (auto &part : parts) {
+		part->reset();
+	}
+	close_scope_writer();
+	for (auto &scope : scopes) {
+		scope->clear();
+	}
+	scope_axis.samples = 0;
+	for (auto &measurement : measurements) {
+		measurement.clear();
+	}
+	for (auto &decimator : decimators) {
+		decimator.reset();
+	}
+
+	set_adaptive(adaptive.enabled, adaptive.settings);
+	operating_point_pending = start_from_operating_point;
+}
+
+void Circuit::set_scope_export_path(const fs::path &path) {
+	// the streamed tables stay in the old directory
+	close_scope_writer();
+
+	scope_export_path = path / make_timestamp();
+	fs::create_directories(scope_export_path);
+	fs::create_directories(path / "latest");
+
+	for (auto &scope : scopes) {
+		scope->set_export_path(scope_export_path);
+	}
+}
+
+static constexpr std::string_view checkpoint_magic = "SimLogue checkpoint";
+static constexpr size_t checkpoint_version = 3;
+
+void Circuit::save_checkpoint(std::ostream &stream) {
+	if (!prepared) allocate();
+
+	CheckpointWriter out(stream);
+
+	out.write_string(checkpoint_magic);
+	out.write_size(checkpoint_version);
+	out.write_size(sizeof(scalar));
+
+	// what the state belongs to, it is checked when loading
+	out.write_size(parts.size());
+	for (const auto &part : parts) out.write_string(part->get_name());
+	out.write_size(nodes.size());
+	out.write_size(matrix.n());
+	out.write_size(sample_values.size());
+	out.write_scalar(timestep);
+	out.write_size(static_cast<size_t>(method));
+	out.write_size(oversampling);
+	out.write_bool(adaptive.enabled);
+
+	out.write_size(step);
+	out.write_scalar(time);
+	out.write_bool(operating_point_pending);
+
+	// the node voltages and the currents of the parts
+	out.write_scalars(solution.elements());
+
+	for (const auto &part : parts) part->save_checkpoint(out);
+
+	out.write_bool(adaptive.started);
+	out.write_scalar(adaptive.prev_time);
+	out.write_scalar(adaptive.now_time);
+	out.write_scalar(adaptive.next_timestep);
+	out.write_scalars(adaptive.prev_values);
+	out.write_scalars(adaptive.now_values);
+	out.write_size(adaptive.solves);
+	out.write_size(adaptive.rejections);
+
+	out.write_scalars(sample_values);
+	for (const auto &decimator : decimators) decimator.save_checkpoint(out);
+	for (const auto &scope : scopes) scope->save_checkpoint(out);
+	for (const auto &measurement : measurements) measurement.save_checkpoint(out);
+
+	// a new analysis at the restored values could choose other pivots, which round differently
+	out.write_size(analysis_count);
+	out.write_bool(lu_plan != nullptr);
+	if (lu_plan) lu_plan->save(out);
+
+	std::vector<size_t> structure;
+	for (size_t i = 0; i < matrix_structure.size(); ++i) {
+		if (matrix_structure[i]) structure.push_back(i);
+	}
+	out.write_sizes(structure);
+
+	if (!stream) throw std::runtime_error("Cannot write the checkpoint.");
+}
+
+void Circuit::save_checkpoint(const fs::path &path) {
+	std::ofstream f(path, std::ios::binary);
+	if (!f) throw std::runtime_error("Cannot open checkpoint file: " + path.string());
+
+	save_checkpoint(f);
+	if (verbose) std::cout << "Saved checkpoint " << path << " at time=" << time << " (step=" << step << ")" << std::endl;
+}
+
+void Circuit::load_checkpoint(std::istream &stream) {
+	if (!prepared) allocate();
+
+	CheckpointReader in(stream);
+
+	const auto mismatch = [](std::string_view what) {
+		return std::runtime_error(std::format("The checkpoint was saved with a different {}.", what));
+	};
+
+	if (in.read_string() != checkpoint_magic) throw std::runtime_error("Not a checkpoint.");
+	if (in.read_size() != checkpoint_version) throw mismatch("version");
+	if (in.read_size() != sizeof(scalar)) throw mismatch("precision");
+
+	if (in.read_size() != parts.size()) throw mismatch("circuit");
+	for (const auto &part : parts) {
+		if (in.read_string() != part->get_name()) throw mismatch("circuit");
+	}
+	if (in.read_size() != nodes.size() || in.read_size() != matrix.n()) throw mismatch("circuit");
+	if (in.read_size() != sample_values.size()) throw mismatch("set of scopes, measurements and outputs");
+	if (in.read_scalar() != timestep) throw mismatch("samplerate");
+	if (in.read_size() != static_cast<size_t>(method)) throw mismatch("integration method");
+	if (in.read_size() != oversampling) throw mismatch("oversampling");
+	if (in.read_bool() != adaptive.enabled) throw mismatch("stepping");
+
+	step = in.read_size();
+	time = in.read_scalar();
+	operating_point_pending = in.read_bool();
+
+	in.read_scalars(solution.elements());
+
+	for (auto &part : parts) part->load_checkpoint(in);
+
+	adaptive.started = in.read_bool();
+	adaptive.prev_time = in.read_scalar();
+	adaptive.now_time = in.read_scalar();
+	adaptive.next_timestep = in.read_scalar();
+	adaptive.prev_values = in.read_scalars();
+	adaptive.now_values = in.read_scalars();
+	adaptive.solves = in.read_size();
+	adaptive.rejections = in.read_size();
+
+	in.read_scalars(sample_values);
+	for (auto &decimator : decimators) decimator.load_checkpoint(in);
+	for (auto &scope : scopes) scope->load_checkpoint(in);
+	for (auto &measurement : measurements) measurement.load_checkpoint(in);
+
+	analysis_count = in.read_size();
+	if (in.read_bool()) {
+		auto plan = lingebra::LUPlan::load(in);
+		if (plan.dim() != matrix.n()) throw mismatch("circuit");
+		lu_plan = std::make_shared<const lingebra::LUPlan>(std::move(plan));
+	}
+	else {
+		lu_plan.reset();
+	}
+	// the factorization only clears the pattern of the plan
+	matrix.clear();
+
+	std::fill(matrix_structure.begin(), matrix_structure.end(), 0);
+	for (size_t i : in.read_sizes()) {
+		if (i >= matrix_structure.size()) throw mismatch("circuit");
+		matrix_structure[i] = 1;
 	}
 }
 
+void Circuit::load_checkpoint(const fs::path &path) {
+	std::ifstream f(path, std::ios::binary);
+	if (!f) throw std::runtime_error("Cannot open checkpoint file: " + path.string());
+
+	load_checkpoint(f);
+	if (verbose) std::cout << "Loaded checkpoint " << path << " at time=" << time << " (step=" << step << ")" << std::endl;
+}
+
 void Circuit::run_for_seconds(scalar secs) {
 	run_for_steps(static_cast<size_t>(secs / timestep));
 }
 
 // scopes
-void Circuit::scope_voltage(const ConstPin &a, const ConstPin &b) {
-	scopes.push_back(std::make_unique<VoltageScope>(a, b, scope_export_path));
+Scope &Circuit::scope_voltage(const ConstPin &a, const ConstPin &b) {
+	prepared = false;
+	return *scopes.emplace_back(std::make_unique<VoltageScope>(a, b, scope_export_path));
 }
 
-void Circuit::scope_current(const ConstPin &a, const ConstPin &b) {
-	scopes.push_back(std::make_unique<CurrentScope>(a, b, scope_export_path));
+Scope &Circuit::scope_current(const ConstPin &a, const ConstPin &b) {
+	prepared = false;
+	return *scopes.emplace_back(std::make_unique<CurrentScope>(a, b, scope_export_path));
 }
 
-void Circuit::export_tables() const {
-	std::cout << "Exporting tables..." << std::endl;
+Measurement &Circuit::add_measurement(const Probe &probe) {
+	prepared = false;
+	return measurements.emplace_back(probe, timestep);
+}
+
+void Circuit::print_measurements() const {
+	for (const auto &measurement : measurements) {
+		const auto summary = measurement.summary();
+
+		std::cout << "Measured " << measurement.get_name() << " over " << summary.samples << " samples:"
+			<< " mean=" << summary.mean << " stddev=" << summary.stddev << " rms=" << summary.rms
+			<< " min=" << summary.min << " max=" << summary.max;
+		if (summary.frequency) std::cout << " frequency=" << *summary.frequency << "Hz";
+		if (summary.thd) std::cout << " thd=" << *summary.thd * 100.0 << "%";
+		std::cout << "\n";
+	}
+	std::cout << std::flush;
+}
+
+void Circuit::set_scope_decimation(const Scope::Decimation &decimation) {
+	for (auto &scope : scopes) {
+		if (scope->get_decimation().mode == Scope::Decimation::Mode::None && scope->on_time_axis()) scope->set_decimation(decimation);
+	}
+}
+
+void Circuit::set_table_streaming(size_t chunk_size) {
+	close_scope_writer();
+	table_chunk_size = chunk_size;
+}
 
+void Circuit::begin_recording(size_t samples) {
+	if (scope_axis.samples == 0) scope_axis.start = time;
+
+	open_scope_writer();
+	for (auto &scope : scopes) {
+		scope->reserve(samples);
+	}
+}
+
+void Circuit::open_scope_writer() {
+	if (table_chunk_size == 0 || scope_writer || scopes.empty()) return;
+	if (table_format != TableFormat::Csv) throw std::runtime_error("Only the csv tables of the scopes can be streamed.");
+
+	std::vector<fs::path> paths;
+	std::vector<std::string> headers;
+	std::vector<size_t> strides;
 	for (const auto &scope : scopes) {
-		scope->export_table();
+		// the windows of the triggered scopes and the spectra stay in memory, they do not grow with the run
+		if (!scope->on_time_axis()) continue;
+
+		paths.push_back(scope_export_path / scope->table_filename());
+		headers.push_back(scope->table_header());
+		strides.push_back(scope->stride());
+	}
+
+	scope_writer = std::make_unique<ScopeWriter>(paths, headers, strides, scope_axis);
+	size_t table = 0;
+	for (const auto &scope : scopes) {
+		if (scope->on_time_axis()) scope->stream_to(*scope_writer, table++, table_chunk_size);
+	}
+}
+
+void Circuit::close_scope_writer() {
+	if (!scope_writer) return;
+
+	std::unique_ptr<ScopeWriter> writer = std::move(scope_writer);
+
+	// a failed submit leaves the error in the writer, close() rethrows it
+	for (auto &scope : scopes) {
+		try {
+			scope->end_stream();
+		}
+		catch (...) {}
 	}
+
+	writer->close();
+}
+
+size_t Circuit::add_input(const std::string &name, DrivablePart *source) {
+	for (const auto &input : inputs) {
+		if (input.name == name) throw std::runtime_error(std::format("Redefinition of input '{}'.", name));
+	}
+	inputs.push_back({ .name = name, .source = source });
+	return inputs.size() - 1;
+}
+
+size_t Circuit::add_output(const std::string &name, const Probe &probe) {
+	for (const auto &output : outputs) {
+		if (output.name == name) throw std::runtime_error(std::format("Redefinition of output '{}'.", name));
+	}
+	prepared = false;
+	outputs.push_back({ .name = name, .probe = probe });
+	return outputs.size() - 1;
+}
+
+size_t Circuit::get_input_id(const std::string &name) const {
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (inputs[i].name == name) return i;
+	}
+	throw std::out_of_range(std::format("The circuit does not have input '{}'.", name));
+}
+
+size_t Circuit::get_output_id(const std::string &name) const {
+	for (size_t i = 0; i < outputs.size(); ++i) {
+		if (outputs[i].name == name) return i;
+	}
+	throw std::out_of_range(std::format("The circuit does not have output '{}'.", name));
+}
+
+void Circuit::export_tables(size_t num_threads) {
+	if (verbose) std::cout << "Exporting tables..." << std::endl;
+
+	close_scope_writer();
+
+	// the other formats write the time tables of all scopes at once
+	const bool time_tables = table_format == TableFormat::Csv;
+	if (table_format == TableFormat::JoinedCsv) export_joined_table();
+	else if (!time_tables) export_binary_tables();
+
+	// the scopes are written in parallel and reported in order afterwards
+	std::vector<std::vector<fs::path>> exported(scopes.size());
+	std::atomic<size_t> next_scope = 0;
+	std::exception_ptr error = nullptr;
+	std::mutex error_mutex;
+
+	auto worker = [&] {
+		for (size_t i; (i = next_scope++) < scopes.size();) {
+			try {
+				// the windows of the triggered scopes and the spectra are not on the grid of the other formats
+				exported[i] = scopes[i]->export_table(scope_axis, time_tables || !scopes[i]->on_time_axis());
+			}
+			catch (...) {
+				std::lock_guard lock(error_mutex);
+				if (!error) error = std::current_exception();
+			}
+		}
+	};
+
+	if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = std::min(num_threads, scopes.size());
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < num_threads; ++t) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	if (error) std::rethrow_exception(error);
+
+	export_measurements();
+
+	if (verbose) {
+		for (size_t i = 0; i < scopes.size(); ++i) {
+			for (const auto &path : exported[i]) {
+				std::cout << "Exported " << scopes[i]->get_values_name() << " table " << path << "\n";
+			}
+		}
+		std::cout << std::flush;
+	}
+}
+
+void Circuit::export_binary_tables() {
+	// the time tables of all scopes share the time base of the circuit
+	std::vector<TableColumn> columns;
+	for (const auto &scope : scopes) {
+		scope->table_columns(columns);
+	}
+
+	// a run with just the ac analysis has no time tables
+	if (scope_axis.samples > 0) {
+		const fs::path path = scope_export_path / "tables.simtab";
+		write_table_file(path, table_format, scope_axis.start, scope_axis.timestep, columns);
+		link_into(path, scope_export_path.parent_path() / "latest");
+
+		if (verbose) std::cout << "Exported binary tables " << path << std::endl;
+	}
+}
+
+void Circuit::export_joined_table() {
+	// the columns are named by their scopes, e.g. voltage-between-a-and-b_min
+	std::vector<TableColumn> columns;
+	for (const auto &scope : scopes) {
+		const size_t first = columns.size();
+		scope->table_columns(columns);
+
+		for (size_t i = first; i < columns.size(); ++i) {
+			columns[i].name = scope->get_name() + columns[i].name.substr(scope->get_values_name().size());
+		}
+	}
+
+	if (scope_axis.samples > 0) {
+		const fs::path path = scope_export_path / "scopes.csv";
+		write_joined_csv(path, scope_axis.start, scope_axis.timestep, columns);
+		link_into(path, scope_export_path.parent_path() / "latest");
+
+		if (verbose) std::cout << "Exported joined table " << path << std::endl;
+	}
+}
+
+void Circuit::export_measurements() {
+	if (measurements.empty()) return;
+
+	const fs::path path = scope_export_path / "measurements.csv";
+	CsvWriter file(path);
+
+	file.text("measurement,samples,mean,stddev,rms,min,max,frequency,thd");
+	file.end_row();
+
+	for (const auto &measurement : measurements) {
+		const auto summary = measurement.summary();
+
+		file.text(measurement.get_name());
+		file.comma();
+		file.text(std::to_string(summary.samples));
+		for (scalar value : { summary.mean, summary.stddev, summary.rms, summary.min, summary.max }) {
+			file.comma();
+			file.number(value);
+		}
+		// empty when not known
+		for (const auto &value : { summary.frequency, summary.thd }) {
+			file.comma();
+			if (value) file.number(*value);
+		}
+		file.end_row();
+	}
+
+	file.close();
+	link_into(path, scope_export_path.parent_path() / "latest");
+
+	if (verbose) std::cout << "Exported measurements " << path << std::endl;
 }
 
 void Circuit::show_graphs() const {
@@ -196,6 +1312,10 @@ void Circuit::show_graphs() const {
 	using sciplot::Figure;
 	using sciplot::Canvas;
 
+	if (table_chunk_size > 0) {
+		throw std::runtime_error("The graphs need the whole recording, they cannot be shown when the tables are streamed.");
+	}
+
 	// calculate the plot grid dimensions to be 16:9
 	size_t n = scopes.size();
 
@@ -204,13 +1324,18 @@ void Circuit::show_graphs() const {
 
 	std::vector<std::vector<PlotVariant>> plot_grid(h, std::vector<PlotVariant>(w));
 
+	// about a point per pixel of a plot, gnuplot reads them from binary files
+	const size_t canvas_width = 1920 * 3 / 5;
+	const size_t canvas_height = 1080 * 3 / 5;
+	PlotData data;
+
 	for (size_t i = 0; i < n; ++i) {
-		scopes[i]->plot(std::get<Plot2D>(plot_grid[i / w][i % w]));
+		scopes[i]->plot(std::get<Plot2D>(plot_grid[i / w][i % w]), scope_axis, data, canvas_width / w);
 	}
 
 	Figure figure(plot_grid);
 	Canvas canvas{ {figure} };
-	canvas.size(1920 * 3 / 5, 1080 * 3 / 5);
+	canvas.size(canvas_width, canvas_height);
 
 	canvas.defaultPalette("set1");
 
@@ -218,7 +1343,7 @@ void Circuit::show_graphs() const {
 }
 
 void Circuit::load_circuit(const fs::path &script) {
-	std::cout << "Loading circuit " << script << std::endl;
+	if (verbose) std::cout << "Loading circuit " << script << std::endl;
 
 	std::ifstream f(script);
 
@@ -226,7 +1351,8 @@ void Circuit::load_circuit(const fs::path &script) {
 		throw std::runtime_error("Cannot open script file: " + script.string());
 	}
 
+	interpreter->base_dir = script.parent_path();
 	interpreter->execute(f);
 
-	std::cout << "Loaded circuit" << std::endl;
+	if (verbose) std::cout << "Loaded circuit" << std::endl;
 }
\ No newline at end of file
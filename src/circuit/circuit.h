@@ -1,39 +1,200 @@
 #pragma once
 
+#include "circuit/integration.h"
+#include "circuit/measurement.h"
+#include "circuit/name_table.h"
 #include "circuit/node.h"
 #include "circuit/part.h"
 #include "circuit/parts/voltage_source.h"
 #include "circuit/pin.h"
+#include "circuit/probe.h"
 #include "circuit/scalar.h"
 #include "circuit/scope.h"
+#include "circuit/scope_writer.h"
+#include "circuit/time_axis.h"
+#include "dsp/decimator.h"
+#include "io/table_file.h"
 #include "lingebra/lingebra.h"
+#include "lingebra/lu.h"
 
 #include <filesystem>
+#include <format>
+#include <istream>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
 
 class Interpreter;
 
+struct AdaptiveSettings {
+	ErrorTolerance tolerance;
+	scalar min_timestep = 0.0; // 0 uses timestep * 1e-6
+	scalar max_timestep = 0.0; // 0 uses timestep * 1000
+};
+
 class Circuit {
 private:
 	std::vector<std::unique_ptr<Node>> nodes;
 	std::vector<std::unique_ptr<Part>> parts;
 
+	// the names of the parts, which refer to them by their id in it, and the parts by the id of their name
+	NameTable names;
+	std::vector<Part *> parts_by_name;
+
 	VoltageSource *ground;
 
 	std::vector<std::unique_ptr<Scope>> scopes;
+	std::vector<Measurement> measurements;
+
+	struct Input {
+		std::string name;
+		DrivablePart *source;
+	};
+
+	struct Output {
+		std::string name;
+		Probe probe;
+	};
+
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
 
 	scalar timestep;
+	IntegrationMethod method;
 	fs::path scope_export_path;
 
+	// the times of the samples the scopes have recorded, shared by all of them
+	TimeAxis scope_axis;
+
+	TableFormat table_format;
+	// rows per chunk of the streamed scope tables, 0 when the scopes are kept in memory
+	size_t table_chunk_size;
+	std::unique_ptr<ScopeWriter> scope_writer;
+
+	// starts the time axis when nothing is recorded yet and prepares the scopes for the next samples
+	void begin_recording(size_t samples);
+	// starts streaming the scope tables, when they are streamed and not open yet
+	void open_scope_writer();
+	// finishes the streamed tables, rethrows the error of the writer
+	void close_scope_writer();
+	// writes the time tables of all scopes into tables.simtab
+	void export_binary_tables();
+	// writes the time tables of all scopes into scopes.csv
+	void export_joined_table();
+	// writes the summaries of the measurements into measurements.csv
+	void export_measurements();
+
+	// prints the progress messages, the batch runner silences its circuits
+	bool verbose;
+
+	// the simulation continues from here on the next run or block
+	size_t step;
+	scalar time;
+
+	// buffers reused by every step, allocated by prepare()
+	bool prepared;
+	std::optional<ConstPin> ground_pin;
+	std::vector<MatrixEntry> matrix_entries;
+	lingebra::Matrix<scalar> matrix;
+	// the parts stamp straight into the right hand side, which the substitution uses up
+	lingebra::Vector<scalar> rhs;
+	// The state of the circuit: the node voltages followed by the rows of the parts. Every step is solved into it
+	// and the nodes and parts read their values there, bound by bind_solution() whenever it is allocated.
+	lingebra::Vector<scalar> solution;
+
+	// the pivot order and pattern of the matrix, shared by the variants of a sweep
+	std::shared_ptr<const lingebra::LUPlan> lu_plan;
+	// positions ever stamped by the parts (n * n), the next analysis covers all of them
+	std::vector<char> matrix_structure;
+	size_t analysis_count;
+
+	// Adaptive stepping: the internal steps grow and shrink with the local truncation error
+	// and the scopes and outputs are interpolated onto the timestep.
+	struct AdaptiveState {
+		bool enabled = false;
+		AdaptiveSettings settings;
+
+		bool started = false;
+		// the start and the end of the last accepted internal step
+		scalar prev_time = 0.0;
+		scalar now_time = 0.0;
+		scalar next_timestep = 0.0;
+
+		// the scopes followed by the outputs, measured at prev_time and now_time
+		std::vector<scalar> prev_values;
+		std::vector<scalar> now_values;
+
+		size_t solves = 0;
+		size_t rejections = 0;
+	};
+
+	AdaptiveState adaptive;
+
+	// the circuit takes oversampling steps per timestep and the scopes and outputs are decimated back
+	size_t oversampling;
+	std::vector<Decimator> decimators;
+	// the scopes, the measurements and the outputs at the current sample
+	std::vector<scalar> sample_values;
+	inline size_t first_output_value() const noexcept { return scopes.size() + measurements.size(); }
+
+	// the first step starts from the dc operating point, it is solved before the next step 0
+	bool start_from_operating_point;
+	bool operating_point_pending;
+	// the solution of the previous operating point iteration
+	std::vector<scalar> op_previous;
+
+	static constexpr scalar op_gmin = 1e-12;
+	static constexpr scalar op_gmin_start = 1e-2;
+	static constexpr size_t op_source_steps = 10;
+	static constexpr size_t op_max_iterations = 100;
+	static constexpr scalar op_tolerance = 1e-9;
+
+	static constexpr size_t pss_max_iterations = 20;
+	static constexpr scalar pss_tolerance = 1e-6;
 
 	Node *create_new_node();
 
-	lingebra::Matrix<scalar> build_matrix(const StampParams &params) const;
-	void update(size_t step, scalar t);
+	// checks the circuit and allocates the buffers of the simulation, prepare() also analyzes the matrix
+	void allocate();
+
+	void build_matrix(const StampParams &params);
+	// writes the stamped entries into the matrix, returns false when some entry is outside the pattern of the plan
+	bool fill_matrix();
+	void factorize_matrix();
+
+	// solves one step and hands the results to the nodes and parts, the parts keep their state
+	void solve_step(const StampParams &params);
+	// the parts take the solved step as their new state
+	void commit_step(const StampParams &params);
+	void update(scalar t, scalar h);
+	// simulates one timestep and fills sample_values, the scopes and measurements are skipped unless measure_scopes is set
+	void simulate_sample(bool measure_scopes);
+	// hands the sample to the scopes and measurements
+	void record_sample();
+
+	scalar min_adaptive_timestep() const noexcept;
+	scalar max_adaptive_timestep() const noexcept;
+	// takes accepted internal steps until the last one ends at or after target_time
+	void advance_adaptive(scalar target_time);
+	void measure_adaptive_values();
+	// value i (scopes, measurements, then outputs) at the time t within the last accepted step
+	scalar interpolate_adaptive(size_t i, scalar t) const noexcept;
+
+	// solves the dc circuit until the modes of the parts settle, returns false on a singular matrix or no convergence
+	bool iterate_operating_point(scalar gmin, scalar source_scale);
+
+	// the states of all parts one after another
+	size_t state_size() const;
+	void save_state(std::span<scalar> state) const;
+	void load_state(std::span<const scalar> state);
 
 	std::unique_ptr<class Interpreter> interpreter;
 
@@ -42,47 +203,186 @@ public:
 	~Circuit() noexcept;
 
 
+	// the part is constructed from its interned name and the rest of the arguments,
+	// throws std::invalid_argument when the circuit already has a part of that name
 	template <class TPart, class... TArgs>
 		requires (std::is_base_of_v<Part, TPart>)
-	TPart *add_part(TArgs&&... args) {
-		auto part = std::make_unique<TPart>(std::forward<TArgs>(args)...);
+	TPart *add_part(std::string_view name, TArgs&&... args) {
+		const NameId id = names.intern(name);
+		if (id < parts_by_name.size() && parts_by_name[id] != nullptr) {
+			throw std::invalid_argument(std::format("Redefinition of part '{}'.", name));
+		}
+
+		auto part = std::make_unique<TPart>(PartName{ .table = &names, .id = id }, std::forward<TArgs>(args)...);
 		TPart *raw = part.get();
 		parts.push_back(std::move(part));
+		if (id >= parts_by_name.size()) parts_by_name.resize(id + 1, nullptr);
+		parts_by_name[id] = raw;
+		prepared = false;
 
 		return raw;
 	}
 
 	VoltageSource *get_ground() const;
 
+	// finds a part by its name, nullptr when there is none
+	Part *find_part(std::string_view name) const noexcept;
+	// finds a part by its name, throws std::out_of_range when there is none
+	Part &get_part(std::string_view name);
+
 	void connect(const Pin &pin_a, const Pin &pin_b);
 
 	inline void set_timestep(scalar dt) { timestep = dt; }
 	inline scalar get_timestep() const { return timestep; }
 
-	void scope_voltage(const ConstPin &a, const ConstPin &b);
+	// the companion model of the capacitors and inductors, can be changed between the steps
+	inline void set_integration_method(IntegrationMethod m) noexcept { method = m; }
+	inline IntegrationMethod get_integration_method() const noexcept { return method; }
+
+	// With adaptive stepping the circuit picks its own internal steps and the timestep only sets the rate
+	// at which the scopes and outputs are sampled. The fixed stepping labels each step by its start time,
+	// the adaptive one samples the interpolated solution at the exact time.
+	void set_adaptive(bool enabled, const AdaptiveSettings &settings = {});
+	inline bool is_adaptive() const noexcept { return adaptive.enabled; }
+	// number of solved internal steps and of the rejected ones among them
+	inline size_t get_adaptive_solves() const noexcept { return adaptive.solves; }
+	inline size_t get_adaptive_rejections() const noexcept { return adaptive.rejections; }
+
+	// Runs factor internal steps (or adaptive samples) per timestep and decimates the scopes and outputs
+	// to the timestep with a lowpass FIR filter, so they do not alias. The filter delays them by about
+	// Decimator::default_taps_per_phase / 2 timesteps. Takes effect on the next prepare().
+	void set_oversampling(size_t factor);
+	inline size_t get_oversampling() const noexcept { return oversampling; }
+
+	// With the operating point start the capacitors and inductors begin in the dc steady state of the circuit
+	// at the start time instead of at zero. It is solved on the first run or block after a reset.
+	void set_start_from_operating_point(bool enabled) noexcept;
+	inline bool starts_from_operating_point() const noexcept { return start_from_operating_point; }
+
+	// Solves the dc operating point (capacitors open, inductors shorted) and seeds the state of the parts with it.
+	// Falls back to gmin stepping and then source stepping when the plain solve fails. When all of them fail,
+	// the parts are reset to zero and it returns false. It allocates on the first call, like prepare().
+	bool solve_operating_point();
+
+	// Finds the periodic steady state of a circuit driven with the given period (e.g. by its ac sources) using
+	// the shooting method: Newton's method on the state at the start of the period, so that simulating one period
+	// ends in the same state, the jacobian of the period comes from finite differences. The period is simulated
+	// with fixed steps of at most timestep / oversampling fitting into it a whole number of times. On success
+	// the parts are left in the periodic state at the current time, otherwise in the state they had before.
+	// Scheduled switch events must not fall into the first period, they are not periodic.
+	bool find_periodic_steady_state(scalar period);
+
+	// Small-signal ac analysis around the present state (the operating point when the circuit starts from it):
+	// solves the complex system of the linearized circuit driven by the phasors of the ac sources at points
+	// frequencies spaced logarithmically from f_start to f_stop, and records the phasors into the scopes.
+	// The points run on num_threads threads (0 uses all hardware threads) and share one LU analysis.
+	// A point with a singular matrix is recorded as NaN.
+	void run_ac_sweep(scalar f_start, scalar f_stop, size_t points, size_t num_threads = 0);
+
+	inline void set_verbose(bool v) { verbose = v; }
+
+	// Restores the state before the first step: time, node voltages, part states and scope recordings.
+	// Keeps the parts, their parameters and the prepared structure, so variants of a sweep can reuse the circuit.
+	void reset();
+	// Writes the complete state of the simulation into a binary checkpoint: the time and the step, the node voltages
+	// and the solution, the state of every part including pending switch events, the adaptive stepping, the decimators
+	// and the LU plan. Loading it into the same circuit (the same parts and stepping) continues bit for bit,
+	// the parameters of the parts may differ, e.g. to start the variants of a sweep from a warmed-up state.
+	// The scope recordings are not included, a restored run records from the checkpoint on.
+	void save_checkpoint(std::ostream &stream);
+	void save_checkpoint(const fs::path &path);
+	// throws std::runtime_error when the checkpoint is of a different circuit or stepping
+	void load_checkpoint(std::istream &stream);
+	void load_checkpoint(const fs::path &path);
+
+	// following exports go into path/<timestamp>/, like the export path given to the constructor
+	void set_scope_export_path(const fs::path &path);
+
+	// The LU plan (pivot order and sparsity pattern) is computed on the first step and whenever the pattern
+	// changes or a pivot breaks down. Circuits with the same topology can share it to skip the analysis.
+	inline std::shared_ptr<const lingebra::LUPlan> get_lu_plan() const noexcept { return lu_plan; }
+	void set_lu_plan(std::shared_ptr<const lingebra::LUPlan> plan);
+	inline size_t get_analysis_count() const noexcept { return analysis_count; }
+
+	// the new scope, its decimation or trigger can be set on it
+	Scope &scope_voltage(const ConstPin &a, const ConstPin &b);
 	// Pin a and b must be of the same part or the single pin voltage source and ground pin
-	void scope_current(const ConstPin &a, const ConstPin &b);
+	Scope &scope_current(const ConstPin &a, const ConstPin &b);
 
 	template <class PartT>
 		requires std::is_base_of_v<Part, PartT>
-	inline void scope_current(const PartT *part) {
+	inline Scope &scope_current(const PartT *part) {
 		if (part->pin_count() != 2) {
 			throw std::runtime_error("You can only directly scope parts with 2 pins.");
 		}
-		scope_current(part->pin(0), part->pin(1));
+		return scope_current(part->pin(0), part->pin(1));
 	}
-	inline void scope_current(const VoltageSource *part) {
-		scope_current(part->pin(0), get_ground()->pin(0));
+	inline Scope &scope_current(const VoltageSource *part) {
+		return scope_current(part->pin(0), get_ground()->pin(0));
 	}
 
-	void export_tables() const;
+	// Measures the quantity of the probe while the scopes record, see Measurement. The reference is valid
+	// until the next measurement is added.
+	Measurement &add_measurement(const Probe &probe);
+	inline const std::vector<Measurement> &get_measurements() const noexcept { return measurements; }
+	// prints the summaries of the measurements
+	void print_measurements() const;
+
+	// decimates the scopes that do not have their own decimation or a trigger, drops what they recorded
+	void set_scope_decimation(const Scope::Decimation &decimation);
+
+	// With a chunk size the scope tables are written while the circuit runs: a writer thread appends chunks
+	// of chunk_size rows to <name>.csv, so the memory does not grow with the run. export_tables() finishes them,
+	// a run after it starts them anew. The graphs need the whole recording, they cannot be shown then. 0 turns it off.
+	void set_table_streaming(size_t chunk_size);
+
+	// With a binary format export_tables() writes the time tables of all scopes into one tables.simtab,
+	// see io/table_file.h, with JoinedCsv into one scopes.csv with a single time column, which needs
+	// the same decimation for all scopes. The ac tables stay csv. Only the csv tables can be streamed.
+	inline void set_table_format(TableFormat format) noexcept { table_format = format; }
+
+	// the times of the recorded samples, see TimeAxis
+	inline const TimeAxis &get_time_axis() const noexcept { return scope_axis; }
+
+	// Inputs drive the designated sources and outputs read the designated probes in process_block,
+	// both are indexed in the order they were added. Returns the index of the new input/output.
+	size_t add_input(const std::string &name, DrivablePart *source);
+	size_t add_output(const std::string &name, const Probe &probe);
+
+	size_t get_input_id(const std::string &name) const;
+	size_t get_output_id(const std::string &name) const;
+
+	inline size_t input_count() const noexcept { return inputs.size(); }
+	inline size_t output_count() const noexcept { return outputs.size(); }
+
+	inline const std::string &get_input_name(size_t id) const { return inputs.at(id).name; }
+	inline const std::string &get_output_name(size_t id) const { return outputs.at(id).name; }
+
+	// Writes the tables of the scopes on num_threads threads, 0 uses all hardware threads,
+	// see set_table_format for the binary tables.
+	void export_tables(size_t num_threads = 0);
 	void show_graphs() const;
 
 	void load_circuit(const fs::path &script);
 
+	// Checks the circuit, allocates all buffers used by the simulation and analyzes the matrix of the first step,
+	// the runs call it when needed. Call it before processing blocks from a real-time callback, so that the first block
+	// does not allocate. A pending operating point (see set_start_from_operating_point) is still solved in the first block.
+	void prepare();
+
 	void run_for_steps(size_t num_steps);
 	void run_for_seconds(scalar secs);
 
+	// Simulates n_frames steps without any I/O. After prepare() it does not allocate, unless a step stamps
+	// outside the analyzed pattern or a pivot breaks down and the matrix has to be analyzed again.
+	// input_buffers[i] holds the values of input i for each frame, output_buffers[i] receives the values of output i.
+	// There has to be exactly one buffer per input/output and each one has to hold at least n_frames values.
+	// The scopes are recorded only when record_scopes is set, their memory is reserved before the block.
+	void process_block(size_t n_frames, std::span<const std::span<const scalar>> input_buffers, std::span<const std::span<scalar>> output_buffers, bool record_scopes = false);
+
+	inline size_t get_step() const noexcept { return step; }
+	inline scalar get_time() const noexcept { return time; }
+
 	inline auto get_nodes() const {
 		return nodes | std::views::transform([](const auto &x) -> const auto & { return *x; });
 	}
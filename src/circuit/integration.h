@@ -0,0 +1,140 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+
+// How the reactive parts turn their differential equation into a companion model for one step.
+// Backward Euler is first order and damps, trapezoidal and Gear-2 (BDF2) are second order.
+enum class IntegrationMethod {
+	BackwardEuler,
+	Trapezoidal,
+	Gear2
+};
+
+constexpr std::string_view integration_method_to_string(IntegrationMethod method) noexcept {
+	switch (method) {
+		case IntegrationMethod::BackwardEuler: return "euler";
+		case IntegrationMethod::Trapezoidal: return "trap";
+		case IntegrationMethod::Gear2: return "gear2";
+	}
+	return "";
+}
+
+constexpr std::optional<IntegrationMethod> integration_method_from_string(std::string_view name) noexcept {
+	if (name == "euler") return IntegrationMethod::BackwardEuler;
+	if (name == "trap") return IntegrationMethod::Trapezoidal;
+	if (name == "gear2") return IntegrationMethod::Gear2;
+	return std::nullopt;
+}
+
+// order of the local truncation error is order + 1
+constexpr size_t integration_order(IntegrationMethod method) noexcept {
+	return method == IntegrationMethod::BackwardEuler ? 1 : 2;
+}
+
+
+// The last committed values of a state variable (the voltage of a capacitor, the current of an inductor)
+// and the steps between them. values[0] is the newest, it is steps[0] after values[1].
+// The initial condition counts as the first value.
+struct IntegrationHistory {
+	std::array<scalar, 3> values{};
+	std::array<scalar, 2> steps{};
+	size_t count = 1;
+
+	constexpr void push(scalar value, scalar step) noexcept {
+		values = { value, values[0], values[1] };
+		steps = { step, steps[0] };
+		if (count < values.size()) ++count;
+	}
+
+	// starts over from a constant value, e.g. the dc operating point
+	constexpr void clear(scalar value = 0.0) noexcept {
+		values = { value, value, value };
+		steps = {};
+		count = 1;
+	}
+
+	void save_checkpoint(CheckpointWriter &out) const {
+		out.write_scalars(values);
+		out.write_scalars(steps);
+		out.write_size(count);
+	}
+
+	void load_checkpoint(CheckpointReader &in) {
+		in.read_scalars(values);
+		in.read_scalars(steps);
+		count = in.read_size();
+	}
+};
+
+// The derivative at the end of a step of length h, x'_n = a0 * x_n + a1 * x_{n-1} + a2 * x_{n-2} + b1 * x'_{n-1}.
+// Trapezoidal and Gear-2 fall back to backward Euler until there are two values, the trapezoidal rule
+// would take the unknown derivative at the initial condition, which backward Euler sets for the next step.
+struct DerivativeCoefficients {
+	scalar a0;
+	scalar a1;
+	scalar a2;
+	scalar b1;
+};
+
+constexpr DerivativeCoefficients derivative_coefficients(IntegrationMethod method, const IntegrationHistory &history, scalar h) noexcept {
+	switch (method) {
+		case IntegrationMethod::Trapezoidal:
+			if (history.count >= 2) return { .a0 = 2.0_s / h, .a1 = -2.0_s / h, .a2 = 0.0, .b1 = -1.0 };
+			break;
+
+		case IntegrationMethod::Gear2:
+			if (history.count >= 2) {
+				// variable step BDF2, r is the ratio of this step to the last one
+				const scalar r = h / history.steps[0];
+				return {
+					.a0 = (1.0_s + 2.0_s * r) / (h * (1.0_s + r)),
+					.a1 = -(1.0_s + r) / h,
+					.a2 = r * r / (h * (1.0_s + r)),
+					.b1 = 0.0,
+				};
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return { .a0 = 1.0_s / h, .a1 = -1.0_s / h, .a2 = 0.0, .b1 = 0.0 };
+}
+
+// The local truncation error of the step to x_now of length h, estimated from the divided differences
+// of x_now and the history. It is 0 until there are enough values for the estimate.
+constexpr scalar truncation_error(IntegrationMethod method, const IntegrationHistory &history, scalar x_now, scalar h) noexcept {
+	auto abs = [](scalar x) { return x < 0 ? -x : x; };
+
+	if (history.count < 2) return 0.0;
+
+	const auto &x = history.values;
+	const auto &s = history.steps;
+
+	const scalar d1_now = (x_now - x[0]) / h;
+	const scalar d1_last = (x[0] - x[1]) / s[0];
+	const scalar d2_now = (d1_now - d1_last) / (h + s[0]);
+
+	// h^2/2 * x'' with x'' = 2 * d2, the second order methods use it too until there are three values
+	if (method == IntegrationMethod::BackwardEuler || history.count < 3) {
+		return h * h * abs(d2_now);
+	}
+
+	const scalar d1_prev = (x[1] - x[2]) / s[1];
+	const scalar d2_last = (d1_last - d1_prev) / (s[0] + s[1]);
+	const scalar d3 = (d2_now - d2_last) / (h + s[0] + s[1]);
+
+	// x''' = 6 * d3, trapezoidal h^3/12 * x''', Gear-2 h^2 (h + h_last)^2 / (6 (2h + h_last)) * x'''
+	if (method == IntegrationMethod::Trapezoidal) {
+		return h * h * h * abs(d3) / 2.0;
+	}
+	return h * h * (h + s[0]) * (h + s[0]) * abs(d3) / (2.0 * h + s[0]);
+}
@@ -1,23 +1,25 @@
 #include "circuit/interpreter/interpreter.h"
 
+#include "circuit/measurement.h"
 #include "circuit/parts/ac_voltage_source.h"
 #include "circuit/parts/capacitor.h"
 #include "circuit/parts/current_source.h"
+#include "circuit/parts/file_voltage_source.h"
 #include "circuit/parts/inductor.h"
 #include "circuit/parts/op_amp.h"
 #include "circuit/parts/resistor.h"
 #include "circuit/parts/switch.h"
 #include "circuit/parts/voltage_source.h"
+#include "circuit/scope.h"
 #include "circuit/util.h"
 
+#include <charconv>
 #include <iostream>
 #include <sstream>
 #include <tuple>
 
 
-Interpreter::Interpreter(Circuit &circuit) : circuit(circuit), parsing_comment(false) {
-	parts["GND"] = circuit.get_ground();
-}
+Interpreter::Interpreter(Circuit &circuit) : circuit(circuit), parsing_comment(false) {}
 
 static bool is_first_word_letter(char x) {
 	return (x == '_') || ('a' <= x && x <= 'z') || ('A' <= x && x <= 'Z');
@@ -42,10 +44,10 @@ bool Interpreter::check_name(const std::string &name) {
 Part *Interpreter::parse_part(const std::string &partname, size_t line_idx) const {
 	if (!check_name(partname)) throw ParseError(std::format("Name error on line {}: Invalid part name '{}'.", line_idx, partname));
 
-	auto it = parts.find(partname);
-	if (it == parts.end()) throw ParseError(std::format("Name error on line {}: Unknown part name '{}'.", line_idx, partname));
+	Part *part = circuit.find_part(partname);
+	if (part == nullptr) throw ParseError(std::format("Name error on line {}: Unknown part name '{}'.", line_idx, partname));
 
-	return it->second;
+	return part;
 }
 
 Pin Interpreter::parse_pin(const std::string &pinname, size_t line_idx, bool support_twopin, size_t twopin_part_pin_id) const {
@@ -89,6 +91,45 @@ Pin Interpreter::parse_pin(const std::string &pinname, size_t line_idx, bool sup
 }
 
 
+Probe Interpreter::parse_probe(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, std::string_view keyword) const {
+	if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected token 'current' or 'voltage' after '{}', got ''", line_idx, keyword));
+
+	auto probe_quantity = tokens[curr_token];
+
+	bool is_current_probe = probe_quantity == "current";
+	bool is_voltage_probe = probe_quantity == "voltage";
+
+	if (!is_current_probe && !is_voltage_probe) {
+		throw ParseError(std::format("Syntax error on line {}: Expected token 'current' or 'voltage' after '{}', got '{}'", line_idx, keyword, probe_quantity));
+	}
+
+	auto type = is_current_probe ? Probe::Type::Current : Probe::Type::Voltage;
+
+	if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected token 'of' or 'between' after '{} {}', got ''", line_idx, keyword, probe_quantity));
+
+	auto probe_type = tokens[curr_token];
+
+	if (probe_type == "of") {
+		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected part name after '{} {} of', got ''", line_idx, keyword, probe_quantity));
+		auto part = parse_part(std::string(tokens[curr_token]), line_idx);
+		if (part->pin_count() != 2) throw ParseError(std::format("Syntax error on line {}: Expected a 2-pin part after '{} {} of', got '{}'", line_idx, keyword, probe_quantity, tokens[curr_token]));
+
+		return Probe(type, part->pin(0), part->pin(1));
+	}
+	else if (probe_type == "between") {
+		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected pin name after '{} {} between', got ''", line_idx, keyword, probe_quantity));
+		auto pin_0 = parse_pin(std::string(tokens[curr_token]), line_idx);
+		std::string_view names_and_keyword = "";
+		if (++curr_token >= tokens.size() || (names_and_keyword = tokens[curr_token]) != "and") throw ParseError(std::format("Syntax error on line {}: Expected 'and' after '{} {} between {}', got '{}'", line_idx, keyword, probe_quantity, pin_0.name(), names_and_keyword));
+		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected pin name after '{} {} between {} and', got ''", line_idx, keyword, probe_quantity, pin_0.name()));
+		auto pin_1 = parse_pin(std::string(tokens[curr_token]), line_idx);
+
+		return Probe(type, pin_0, pin_1);
+	}
+
+	throw ParseError(std::format("Syntax error on line {}: Expected token 'of' or 'between' after '{} {}', got '{}'", line_idx, keyword, probe_quantity, probe_type));
+}
+
 Interpreter::Value Interpreter::parse_value(std::string_view value_string, std::string_view where) {
 	std::string number_string = "";
 	number_string.reserve(value_string.size());
@@ -178,7 +219,7 @@ Interpreter::Value Interpreter::parse_value(std::string_view value_string, std::
 
 std::vector<std::string_view> Interpreter::tokenize(std::string_view line) {
 	// tokenize with white space as token separator
-	// ':', '-' and ',' are always treated as self-contained tokens
+	// ':', '-' and ',' are always treated as self-contained tokens, quoted strings too
 	std::vector<std::string_view> tokens;
 
 	size_t token_lo = 0;
@@ -228,6 +269,22 @@ std::vector<std::string_view> Interpreter::tokenize(std::string_view line) {
 
 			token_lo = token_hi + 1;
 		}
+		else if (letter == '"') {
+			// a quoted string is a single token with its quotes, whatever is inside
+			auto token = line.substr(token_lo, token_hi - token_lo);
+			if (!token.empty()) tokens.push_back(token);
+
+			size_t closing = line.find('"', token_hi + 1);
+			if (closing == std::string_view::npos) {
+				// left unterminated for the parser to report
+				tokens.push_back(line.substr(token_hi));
+				return tokens;
+			}
+
+			tokens.push_back(line.substr(token_hi, closing + 1 - token_hi));
+			token_hi = closing;
+			token_lo = token_hi + 1;
+		}
 		else if (letter == ',' || letter == '-' || letter == ':') {
 			auto token = line.substr(token_lo, token_hi - token_lo);
 			if (!token.empty()) tokens.push_back(token);
@@ -307,6 +364,12 @@ void Interpreter::execute_line(std::string_view line, size_t line_idx) {
 			std::array<ParamInfo, 3>{ Frequency, Voltage, { Angle, 0.0_s } }
 		);
 	}
+	else if (token == "file_voltage_source") {
+		add_file_part<FileVoltageSource>(tokens, curr_token, line_idx, "file_voltage_source");
+	}
+	else if (token == "file_voltage_source_2P") {
+		add_file_part<FileVoltageSource2Pin>(tokens, curr_token, line_idx, "file_voltage_source_2P");
+	}
 	else if (token == "op_amp") {
 		add_basic_part<OpAmp>(
 			tokens, curr_token, line_idx, "op_amp",
@@ -317,42 +380,150 @@ void Interpreter::execute_line(std::string_view line, size_t line_idx) {
 	// other keywords
 
 	else if (token == "scope") {
-		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected token 'current' or 'voltage' after 'scope', got ''", line_idx));
-
-		auto scope_quantity = tokens[curr_token];
-
-		bool is_current_scope = scope_quantity == "current";
-		bool is_voltage_scope = scope_quantity == "voltage";
+		auto probe = parse_probe(tokens, curr_token, line_idx, "scope");
 
-		if (is_current_scope || is_voltage_scope) {
-			if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected token 'of' or 'between' after 'scope {}', got ''", line_idx, scope_quantity));
+		Scope &scope = probe.get_type() == Probe::Type::Current ? circuit.scope_current(probe.pin_a(), probe.pin_b()) : circuit.scope_voltage(probe.pin_a(), probe.pin_b());
 
-			auto scope_type = tokens[curr_token];
+		auto parse_count = [&](std::string_view keyword, size_t minimum) {
+			if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a sample count after '{}', got ''", line_idx, keyword));
 
-			if (scope_type != "of" && scope_type != "between") throw ParseError(std::format("Syntax error on line {}: Expected token 'of' or 'between' after 'scope {}', got '{}'", line_idx, scope_quantity, scope_type));
+			auto count = tokens[curr_token];
+			size_t value = 0;
+			auto [ptr, ec] = std::from_chars(count.data(), count.data() + count.size(), value);
+			if (ec != std::errc() || ptr != count.data() + count.size() || value < minimum) {
+				throw ParseError(std::format("Syntax error on line {}: Invalid sample count '{}' after '{}', it has to be a whole number of at least {}.", line_idx, count, keyword, minimum));
+			}
+			return value;
+		};
+
+		// an optional decimation: 'every <n>' or 'envelope <n>', a spectrum: 'spectrum <frame size>', or a trigger:
+		// 'trigger (rising|falling|above|below) <level> [on <probe>] [pre <n>] [post <n>] [holdoff <n>] [single]'
+		if (++curr_token < tokens.size()) {
+			auto mode = tokens[curr_token];
+
+			if (mode == "spectrum") {
+				const size_t frame_size = parse_count(mode, 4);
+				if (++curr_token < tokens.size()) throw ParseError(std::format("Syntax error on line {}: Unexpected '{}' after the frame size of the spectrum.", line_idx, tokens[curr_token]));
+
+				try {
+					scope.set_spectrum(frame_size);
+				}
+				catch (const std::invalid_argument &e) {
+					throw ParseError(std::format("Value error on line {}: {}", line_idx, e.what()));
+				}
+			}
+			else if (mode == "trigger") {
+				Scope::Trigger trigger;
+
+				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected 'rising', 'falling', 'above' or 'below' after 'trigger', got ''", line_idx));
+				auto condition = tokens[curr_token];
+				if (condition == "rising") trigger.mode = Scope::Trigger::Mode::Rising;
+				else if (condition == "falling") trigger.mode = Scope::Trigger::Mode::Falling;
+				else if (condition == "above") trigger.mode = Scope::Trigger::Mode::Above;
+				else if (condition == "below") trigger.mode = Scope::Trigger::Mode::Below;
+				else throw ParseError(std::format("Syntax error on line {}: Expected 'rising', 'falling', 'above' or 'below' after 'trigger', got '{}'", line_idx, condition));
+
+				// the level, '-' is a token of its own
+				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a level after 'trigger {}', got ''", line_idx, condition));
+				const bool negative = tokens[curr_token] == "-";
+				if (negative && ++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a level after 'trigger {} -', got ''", line_idx, condition));
+				const Value level = parse_value(tokens[curr_token], line_idx);
+				trigger.level = negative ? -level.value : level.value;
+
+				while (++curr_token < tokens.size()) {
+					auto option = tokens[curr_token];
+
+					if (option == "on") trigger.source = parse_probe(tokens, curr_token, line_idx, "on");
+					else if (option == "pre") trigger.pre = parse_count(option, 0);
+					else if (option == "post") trigger.post = parse_count(option, 0);
+					else if (option == "holdoff") trigger.holdoff = parse_count(option, 0);
+					else if (option == "single") trigger.single = true;
+					else throw ParseError(std::format("Syntax error on line {}: Expected 'on', 'pre', 'post', 'holdoff' or 'single' after the trigger, got '{}'", line_idx, option));
+				}
+
+				const Probe &source = trigger.source ? *trigger.source : probe;
+				const Quantity source_quantity = source.get_type() == Probe::Type::Current ? Current : Voltage;
+				if (level.quantity != source_quantity) {
+					throw ParseError(std::format("Type error on line {}: The trigger level of a {} has to be a {}.", line_idx, source.get_values_name(), source.get_values_name()));
+				}
+
+				scope.set_trigger(trigger);
+			}
+			else {
+				Scope::Decimation decimation;
+				if (mode == "every") decimation.mode = Scope::Decimation::Mode::Every;
+				else if (mode == "envelope") decimation.mode = Scope::Decimation::Mode::Envelope;
+				else throw ParseError(std::format("Syntax error on line {}: Expected 'every', 'envelope', 'spectrum' or 'trigger' after the scoped {}, got '{}'", line_idx, probe.get_values_name(), mode));
 
-			if (scope_type == "of") {
-				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected part name after 'scope {} of', got ''", line_idx, scope_quantity));
-				auto part = parse_part(std::string(tokens[curr_token]), line_idx);
-				if (part->pin_count() != 2) throw ParseError(std::format("Syntax error on line {}: Expected a 2-pin part after 'scope {} of', got '{}'", line_idx, scope_quantity, tokens[curr_token]));
+				decimation.factor = parse_count(mode, 1);
+				scope.set_decimation(decimation);
+			}
+		}
+	}
+	else if (token == "measure") {
+		auto probe = parse_probe(tokens, curr_token, line_idx, "measure");
+
+		Measurement &measurement = circuit.add_measurement(probe);
+
+		// an optional distortion: 'thd <fundamental> [harmonics <n>]'
+		if (++curr_token < tokens.size()) {
+			if (tokens[curr_token] != "thd") throw ParseError(std::format("Syntax error on line {}: Expected 'thd' after the measured {}, got '{}'", line_idx, probe.get_values_name(), tokens[curr_token]));
+			if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a fundamental frequency after 'thd', got ''", line_idx));
+
+			const Value fundamental = parse_value(tokens[curr_token], line_idx);
+			if (fundamental.quantity != Frequency) throw ParseError(std::format("Type error on line {}: The fundamental after 'thd' has to be a frequency, got '{}'", line_idx, tokens[curr_token]));
+
+			size_t harmonics = Measurement::default_harmonics;
+			if (++curr_token < tokens.size()) {
+				if (tokens[curr_token] != "harmonics") throw ParseError(std::format("Syntax error on line {}: Expected 'harmonics' after the fundamental, got '{}'", line_idx, tokens[curr_token]));
+				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a number of harmonics after 'harmonics', got ''", line_idx));
+
+				auto count = tokens[curr_token];
+				auto [ptr, ec] = std::from_chars(count.data(), count.data() + count.size(), harmonics);
+				if (ec != std::errc() || ptr != count.data() + count.size() || harmonics < 2) {
+					throw ParseError(std::format("Syntax error on line {}: Invalid number of harmonics '{}', it has to be a whole number of at least 2.", line_idx, count));
+				}
+				if (++curr_token < tokens.size()) throw ParseError(std::format("Syntax error on line {}: Unexpected '{}' after the number of harmonics.", line_idx, tokens[curr_token]));
+			}
 
-				if (is_current_scope) circuit.scope_current(part->pin(0), part->pin(1));
-				else circuit.scope_voltage(part->pin(0), part->pin(1));
+			try {
+				measurement.set_thd(fundamental.value, harmonics);
 			}
-			else if (scope_type == "between") {
-				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected pin name after 'scope {} between', got ''", line_idx, scope_quantity));
-				auto pin_0 = parse_pin(std::string(tokens[curr_token]), line_idx);
-				std::string_view names_and_keyword = "";
-				if (++curr_token >= tokens.size() || (names_and_keyword = tokens[curr_token]) != "and") throw ParseError(std::format("Syntax error on line {}: Expected 'and' after 'scope {} between {}', got '{}'", line_idx, scope_quantity, pin_0.name, names_and_keyword));
-				if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected pin name after 'scope {} between {} and', got ''", line_idx, scope_quantity, pin_0.name, names_and_keyword));
-				auto pin_1 = parse_pin(std::string(tokens[curr_token]), line_idx);
-
-				if (is_current_scope) circuit.scope_current(pin_0, pin_1);
-				else circuit.scope_voltage(pin_0, pin_1);
+			catch (const std::invalid_argument &e) {
+				throw ParseError(std::format("Value error on line {}: {}", line_idx, e.what()));
 			}
 		}
-		else {
-			throw ParseError(std::format("Syntax error on line {}: Expected token 'current' or 'voltage' after 'scope', got '{}'", line_idx, scope_quantity));
+	}
+	else if (token == "input") {
+		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected a source name after 'input', got ''", line_idx));
+
+		std::string source_name(tokens[curr_token]);
+		auto source = dynamic_cast<DrivablePart *>(parse_part(source_name, line_idx));
+		if (!source) throw ParseError(std::format("Type error on line {}: {} cannot be used as an input, only voltage and current sources can", line_idx, source_name));
+
+		try {
+			circuit.add_input(source_name, source);
+		}
+		catch (const std::runtime_error &) {
+			throw ParseError(std::format("Syntax error on line {}: Redefinition of input '{}'.", line_idx, source_name));
+		}
+	}
+	else if (token == "output") {
+		if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected output name after 'output', got ''", line_idx));
+		std::string output_name(tokens[curr_token]);
+
+		if (!check_name(output_name)) throw ParseError(std::format("Name error on line {}: Invalid output name '{}'.", line_idx, output_name));
+
+		std::string_view separator = "";
+		if (++curr_token >= tokens.size() || (separator = tokens[curr_token]) != ":") throw ParseError(std::format("Syntax error on line {}: Expected ':' after 'output {}', got '{}'", line_idx, output_name, separator));
+
+		auto probe = parse_probe(tokens, curr_token, line_idx, std::format("output {}:", output_name));
+
+		try {
+			circuit.add_output(output_name, probe);
+		}
+		catch (const std::runtime_error &) {
+			throw ParseError(std::format("Syntax error on line {}: Redefinition of output '{}'.", line_idx, output_name));
 		}
 	}
 	else if (token == "turn") {
@@ -381,10 +552,10 @@ void Interpreter::execute_line(std::string_view line, size_t line_idx) {
 			}
 
 			if (is_on) {
-				switch_part->schedule_on(static_cast<size_t>(t / circuit.get_timestep()));
+				switch_part->schedule_on(t);
 			}
 			else {
-				switch_part->schedule_off(static_cast<size_t>(t / circuit.get_timestep()));
+				switch_part->schedule_off(t);
 			}
 		}
 		else {
@@ -3,12 +3,15 @@
 #include "circuit/circuit.h"
 #include "circuit/interpreter/quantity.h"
 #include "circuit/part.h"
+#include "circuit/probe.h"
 
+#include <array>
+#include <filesystem>
 #include <format>
 #include <istream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
-#include <unordered_map>
 #include <vector>
 
 
@@ -24,7 +27,8 @@ private:
 
 	bool parsing_comment;
 
-	std::unordered_map<std::string, Part *> parts;
+	// the relative file paths in the script are relative to it, set by Circuit::load_circuit
+	fs::path base_dir;
 
 	static bool check_name(const std::string &name);
 
@@ -35,6 +39,8 @@ private:
 
 	Part *parse_part(const std::string &partname, size_t line_idx) const;
 	Pin parse_pin(const std::string &pinname, size_t line_idx, bool support_twopin = false, size_t twopin_part_pin_id = 0) const;
+	// parses '(voltage|current) (of <two-pin part> | between <pin> and <pin>)' following the keyword token at curr_token
+	Probe parse_probe(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, std::string_view keyword) const;
 	void parse_connections(const std::vector<std::string_view> &tokens, size_t line_idx) const;
 
 	std::vector<std::string_view> tokenize(std::string_view line);
@@ -51,6 +57,11 @@ private:
 		ParamInfo(Quantity quantity, scalar default_value) : quantity(quantity), has_default_value(true), default_value(default_value) {}
 	};
 
+	// parses the values following the part name, the first one after ':' when first_param, the others after ',',
+	// and matches them to the constructor signature by their quantities
+	template <size_t N>
+	std::array<scalar, N> parse_part_values(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name, const std::string &partname, const std::array<ParamInfo, N> &constructor_signature, bool first_param);
+
 	// supports all parts with the first constructor argument being string, and then only scalars
 	template <class T, size_t N>
 	void add_basic_part(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name, const std::array<ParamInfo, N> &constructor_signature);
@@ -60,6 +71,10 @@ private:
 		add_basic_part<T, 0>(tokens, curr_token, line_idx, part_type_name, std::array<ParamInfo, 0>());
 	}
 
+	// parts playing a file: '<type> <name>: "<path>"[, <gain (voltage)>][, <sample rate (frequency)>]'
+	template <class T>
+	void add_file_part(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name);
+
 	friend class Circuit;
 	Interpreter(Circuit &circuit);
 
@@ -76,24 +91,14 @@ public:
 
 
 
-template <class T, size_t N>
-void Interpreter::add_basic_part(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name, const std::array<ParamInfo, N> &constructor_signature) {
-	if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected part name after '{}', got ''", line_idx, part_type_name));
-	std::string partname(tokens[curr_token]);
-
-	if (!check_name(partname)) throw ParseError(std::format("Name error on line {}: Invalid part name '{}'.", line_idx, partname));
-	if (parts.find(partname) != parts.end()) throw ParseError(std::format("Syntax error on line {}: Redefinition of part name '{}'.", line_idx, partname));
-
-	Part *part = nullptr;
-
+template <size_t N>
+std::array<scalar, N> Interpreter::parse_part_values(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name, const std::string &partname, const std::array<ParamInfo, N> &constructor_signature, bool first_param) {
 	// parse the constructor values
 	std::array<Value, N> parsed_values{};
 	parsed_values.fill(Value{});
 
 	size_t values_size = 0;
 
-	bool first_param = true;
-
 	for (++curr_token; curr_token < tokens.size(); curr_token += 2) {
 		auto separator = tokens[curr_token];
 		if (curr_token + 1 >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Invalid number of parameters for {} {}.", line_idx, part_type_name, partname));
@@ -153,7 +158,48 @@ void Interpreter::add_basic_part(const std::vector<std::string_view> &tokens, si
 		throw ParseError(std::format("Parameter error on line {}: Unable to find value for parameter {} ({}).", line_idx, i, quantity_to_string(search_quantity)));
 	}
 
-	part = std::apply([&](auto... params) { return circuit.add_part<T>(partname, params...); }, params);
+	return params;
+}
+
+template <class T, size_t N>
+void Interpreter::add_basic_part(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name, const std::array<ParamInfo, N> &constructor_signature) {
+	if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected part name after '{}', got ''", line_idx, part_type_name));
+	std::string partname(tokens[curr_token]);
 
-	parts[partname] = part;
+	if (!check_name(partname)) throw ParseError(std::format("Name error on line {}: Invalid part name '{}'.", line_idx, partname));
+	if (circuit.find_part(partname) != nullptr) throw ParseError(std::format("Syntax error on line {}: Redefinition of part name '{}'.", line_idx, partname));
+
+	auto params = parse_part_values(tokens, curr_token, line_idx, part_type_name, partname, constructor_signature, true);
+
+	std::apply([&](auto... params) { circuit.add_part<T>(partname, params...); }, params);
+}
+
+template <class T>
+void Interpreter::add_file_part(const std::vector<std::string_view> &tokens, size_t &curr_token, size_t line_idx, const std::string &part_type_name) {
+	if (++curr_token >= tokens.size()) throw ParseError(std::format("Syntax error on line {}: Expected part name after '{}', got ''", line_idx, part_type_name));
+	std::string partname(tokens[curr_token]);
+
+	if (!check_name(partname)) throw ParseError(std::format("Name error on line {}: Invalid part name '{}'.", line_idx, partname));
+	if (circuit.find_part(partname) != nullptr) throw ParseError(std::format("Syntax error on line {}: Redefinition of part name '{}'.", line_idx, partname));
+
+	std::string_view separator = "";
+	if (++curr_token >= tokens.size() || (separator = tokens[curr_token]) != ":") throw ParseError(std::format("Syntax error on line {}: Expected ':' after '{} {}', got '{}'", line_idx, part_type_name, partname, separator));
+
+	std::string_view quoted = "";
+	if (++curr_token >= tokens.size() || (quoted = tokens[curr_token]).size() < 2 || !quoted.starts_with('"') || !quoted.ends_with('"')) {
+		throw ParseError(std::format("Syntax error on line {}: Expected a quoted file path after '{} {}:', got '{}'", line_idx, part_type_name, partname, quoted));
+	}
+
+	fs::path path(quoted.substr(1, quoted.size() - 2));
+	if (path.is_relative()) path = base_dir / path;
+
+	using enum Quantity;
+	auto [gain, sample_rate] = parse_part_values(tokens, curr_token, line_idx, part_type_name, partname, std::array<ParamInfo, 2>{{ { Voltage, 1.0 }, { Frequency, 0.0 } }}, false);
+
+	try {
+		circuit.add_part<T>(partname, path, gain, sample_rate);
+	}
+	catch (const std::exception &e) {
+		throw ParseError(std::format("File error on line {}: {}", line_idx, e.what()));
+	}
 }
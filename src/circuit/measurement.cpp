@@ -0,0 +1,155 @@
+#include "circuit/measurement.h"
+
+#include "circuit/checkpoint.h"
+#include "circuit/probe.h"
+#include "circuit/scalar.h"
+#include "dsp/goertzel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+
+Measurement::Measurement(const Probe &probe, scalar timestep) :
+	probe(probe),
+	timestep(timestep) {
+	name = std::format("{}-between-{}-and-{}", probe.get_values_name(), probe.pin_a().name(), probe.pin_b().name());
+	clear();
+}
+
+void Measurement::set_thd(scalar fundamental, size_t harmonics) {
+	const scalar frequency = fundamental * timestep;
+	if (!(frequency > 0.0 && frequency < 0.5)) {
+		throw std::invalid_argument(std::format("The fundamental of the measurement {} has to be between 0 and the Nyquist frequency {}Hz.", name, 0.5 / timestep));
+	}
+
+	bins.clear();
+	for (size_t k = 1; k <= std::max<size_t>(harmonics, 1) && static_cast<scalar>(k) * frequency < 0.5; ++k) {
+		bins.emplace_back(static_cast<scalar>(k) * frequency);
+	}
+	clear();
+}
+
+void Measurement::add(scalar value) noexcept {
+	// a rising crossing of the running mean, placed between the samples by a linear interpolation
+	if (previous && *previous < mean && value >= mean) {
+		const double fraction = (mean - *previous) / (value - *previous);
+		const double at = static_cast<double>(count) - 1.0 + fraction;
+
+		if (crossings >= 2) {
+			const double average = (last_crossing - first_crossing) / static_cast<double>(crossings - 1);
+			if (std::abs(at - last_crossing - average) > period_tolerance * average) {
+				first_crossing = last_crossing;
+				crossings = 1;
+			}
+		}
+
+		if (crossings == 0) first_crossing = at;
+		last_crossing = at;
+		++crossings;
+	}
+	previous = value;
+
+	++count;
+	const double delta = value - mean;
+	mean += delta / static_cast<double>(count);
+	m2 += delta * (value - mean);
+	sum_squares += static_cast<double>(value) * value;
+
+	min = std::min(min, value);
+	max = std::max(max, value);
+
+	for (auto &bin : bins) {
+		bin.push(value);
+	}
+}
+
+void Measurement::clear() noexcept {
+	count = 0;
+	mean = 0.0;
+	m2 = 0.0;
+	sum_squares = 0.0;
+	min = std::numeric_limits<scalar>::infinity();
+	max = -std::numeric_limits<scalar>::infinity();
+
+	previous.reset();
+	crossings = 0;
+	first_crossing = 0.0;
+	last_crossing = 0.0;
+
+	for (auto &bin : bins) {
+		bin.reset();
+	}
+}
+
+void Measurement::save_checkpoint(CheckpointWriter &out) const {
+	out.write_size(count);
+	out.write_double(mean);
+	out.write_double(m2);
+	out.write_double(sum_squares);
+	out.write_scalar(min);
+	out.write_scalar(max);
+
+	out.write_bool(previous.has_value());
+	out.write_scalar(previous.value_or(scalar{ 0 }));
+	out.write_size(crossings);
+	out.write_double(first_crossing);
+	out.write_double(last_crossing);
+
+	out.write_size(bins.size());
+	for (const auto &bin : bins) bin.save_checkpoint(out);
+}
+
+void Measurement::load_checkpoint(CheckpointReader &in) {
+	count = in.read_size();
+	mean = in.read_double();
+	m2 = in.read_double();
+	sum_squares = in.read_double();
+	min = in.read_scalar();
+	max = in.read_scalar();
+
+	const bool has_previous = in.read_bool();
+	const scalar previous_value = in.read_scalar();
+	previous = has_previous ? std::optional<scalar>(previous_value) : std::nullopt;
+	crossings = in.read_size();
+	first_crossing = in.read_double();
+	last_crossing = in.read_double();
+
+	if (in.read_size() != bins.size()) {
+		throw std::runtime_error(std::format("The checkpoint was saved with another distortion measurement of {}.", name));
+	}
+	for (auto &bin : bins) bin.load_checkpoint(in);
+}
+
+Measurement::Summary Measurement::summary() const {
+	Summary summary{
+		.samples = count,
+		.mean = static_cast<scalar>(mean),
+		.stddev = count > 1 ? static_cast<scalar>(std::sqrt(m2 / static_cast<double>(count - 1))) : scalar{ 0 },
+		.rms = count > 0 ? static_cast<scalar>(std::sqrt(sum_squares / static_cast<double>(count))) : scalar{ 0 },
+		.min = count > 0 ? min : scalar{ 0 },
+		.max = count > 0 ? max : scalar{ 0 },
+		.frequency = std::nullopt,
+		.thd = std::nullopt,
+	};
+
+	if (crossings >= 2 && last_crossing > first_crossing) {
+		summary.frequency = static_cast<scalar>(static_cast<double>(crossings - 1) / ((last_crossing - first_crossing) * timestep));
+	}
+
+	if (!bins.empty() && count > 0) {
+		double harmonics_power = 0.0;
+		for (size_t k = 1; k < bins.size(); ++k) {
+			harmonics_power += bins[k].power();
+		}
+
+		const double fundamental_power = bins.front().power();
+		if (fundamental_power > 0.0) summary.thd = static_cast<scalar>(std::sqrt(harmonics_power / fundamental_power));
+	}
+
+	return summary;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/probe.h"
+#include "circuit/scalar.h"
+#include "dsp/goertzel.h"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+// Reduces a probed quantity to a few numbers while the circuit runs, without storing its samples: the mean and
+// the standard deviation (Welford's update), the rms, the extremes, the frequency from the rising crossings of the
+// running mean over the last stretch of steady periods and, with a fundamental, the total harmonic distortion from Goertzel filters at its harmonics.
+// The sums are double, the runs are long.
+class Measurement {
+public:
+	struct Summary {
+		size_t samples;
+		scalar mean;
+		scalar stddev;
+		scalar rms;
+		scalar min;
+		scalar max;
+		// at least two crossings are needed
+		std::optional<scalar> frequency;
+		// the ratio, not in percent, only with a fundamental
+		std::optional<scalar> thd;
+	};
+
+	static constexpr size_t default_harmonics = 10;
+
+private:
+	Probe probe;
+	std::string name;
+	scalar timestep;
+
+	size_t count;
+	double mean;
+	// the sum of the squared differences from the mean
+	double m2;
+	double sum_squares;
+	scalar min;
+	scalar max;
+
+	// The crossings are counted in samples. A period that differs from the average of the counted ones by more
+	// than the tolerance starts the count anew from its first crossing, so that the ripple of a transient at the start
+	// does not count and a changed frequency is measured from the change on.
+	static constexpr double period_tolerance = 0.5;
+	std::optional<scalar> previous;
+	size_t crossings;
+	double first_crossing;
+	double last_crossing;
+
+	// the fundamental first, then its harmonics below the Nyquist frequency
+	std::vector<Goertzel> bins;
+
+public:
+	Measurement(const Probe &probe, scalar timestep);
+
+	// Measures the distortion of the harmonics 2 to harmonics of the fundamental (in Hz), the ones above the
+	// Nyquist frequency are left out. Throws std::invalid_argument when the fundamental is not below it.
+	// Drops what has been measured, like clear().
+	void set_thd(scalar fundamental, size_t harmonics = default_harmonics);
+
+	inline const Probe &get_probe() const noexcept { return probe; }
+	// e.g. voltage-between-C1.a-and-C1.b, like the scopes
+	inline const std::string &get_name() const noexcept { return name; }
+
+	void add(scalar value) noexcept;
+	void clear() noexcept;
+
+	// The running sums, the crossings and the filters, a resumed run measures on as if it had not stopped.
+	// Loading throws std::runtime_error when the measurement was saved with another fundamental or number of harmonics.
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+
+	Summary summary() const;
+};
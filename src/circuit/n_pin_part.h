@@ -1,5 +1,6 @@
 #pragma once
 
+#include "circuit/name_table.h"
 #include "circuit/node.h"
 #include "circuit/part.h"
 
@@ -7,6 +8,8 @@
 #include <format>
 #include <ranges>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 
 
 template <size_t N>
@@ -14,9 +17,9 @@ class NPinPart : public Part {
 private:
 	std::array<Node *, N> nodes;
 
-	std::string name;
+	PartName name;
 
-	std::array<std::string_view, N> pin_names;
+	static constexpr std::string_view pin_letters = "abcdefghijklmnopqrstuvwxyz";
 
 protected:
 	void assert_pin_id(size_t pin_id) const {
@@ -25,20 +28,22 @@ protected:
 		}
 	}
 
+	// direct node access for the stamping code
+	Node *node(size_t pin_id) const noexcept {
+		return nodes[pin_id];
+	}
+
 public:
-	NPinPart(const std::string &name) : name(name) {
+	NPinPart(PartName name) : name(name) {
+		static_assert(N <= pin_letters.size(), "Default pin names only cover parts with up to 26 pins");
 		nodes.fill(nullptr);
-
-		for (size_t i = 0; i < N; ++i) {
-			pin_names[i] = std::format("{}", static_cast<char>('a' + i));
-		}
 	};
 	virtual ~NPinPart() noexcept = default;
 
 	constexpr size_t pin_count() const noexcept override { return N; }
 
-	virtual std::string_view get_pin_name(size_t pin_id) const noexcept {
-		return pin_names[pin_id];
+	std::string_view get_pin_name(size_t pin_id) const noexcept override {
+		return pin_letters.substr(pin_id, 1);
 	}
 
 	void set_node(size_t pin_id, Node *node) override {
@@ -48,16 +53,16 @@ public:
 
 	Pin pin(size_t pin_id) override {
 		assert_pin_id(pin_id);
-		return Pin(pin_id, nodes[pin_id], this, std::format("{}.{}", name, get_pin_name(pin_id)));
+		return Pin(pin_id, nodes[pin_id], this);
 	}
 
 	ConstPin pin(size_t pin_id) const override {
 		assert_pin_id(pin_id);
-		return ConstPin(pin_id, nodes[pin_id], this, std::format("{}.{}", name, get_pin_name(pin_id)));
+		return ConstPin(pin_id, nodes[pin_id], this);
 	}
 
 	Pin pin(const std::string &pinname) override {
-		for (size_t i = 0; i < pin_names.size(); ++i) {
+		for (size_t i = 0; i < N; ++i) {
 			if (get_pin_name(i) == pinname) return pin(i);
 		}
 
@@ -65,18 +70,14 @@ public:
 	}
 
 	ConstPin pin(const std::string &pinname) const override {
-		for (size_t i = 0; i < pin_names.size(); ++i) {
+		for (size_t i = 0; i < N; ++i) {
 			if (get_pin_name(i) == pinname) return pin(i);
 		}
 
 		throw std::out_of_range(std::format("NPinPart<{}> does not have pin {}", N, pinname));
 	}
 
-	const std::string &get_name() const override { return name; }
-
-	void set_name(const std::string &new_name) override {
-		name = new_name;
-	}
+	std::string_view get_name() const override { return name.view(); }
 
 	Pin pin() requires(N == 1) { return pin(0); }
 	ConstPin pin() const requires(N == 1) { return pin(0); }
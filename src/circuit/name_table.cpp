@@ -0,0 +1,63 @@
+#include "circuit/name_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+
+uint32_t NameTable::hash(std::string_view name) noexcept {
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for (char c : name) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+size_t NameTable::slot_of(std::string_view name) const noexcept {
+	const size_t mask = slots.size() - 1;
+	for (size_t slot = hash(name) & mask;; slot = (slot + 1) & mask) {
+		if (slots[slot] == empty_slot || view(slots[slot]) == name) return slot;
+	}
+}
+
+void NameTable::grow() {
+	std::vector<NameId> old = std::move(slots);
+	slots.assign(old.empty() ? 64 : 2 * old.size(), empty_slot);
+
+	for (NameId id : old) {
+		if (id != empty_slot) slots[slot_of(view(id))] = id;
+	}
+}
+
+NameId NameTable::intern(std::string_view name) {
+	if (2 * (ends.size() + 1) > slots.size()) grow();
+
+	const size_t slot = slot_of(name);
+	if (slots[slot] != empty_slot) return slots[slot];
+
+	if (ends.size() >= none || name.size() > std::numeric_limits<uint32_t>::max() - chars.size()) {
+		throw std::length_error("The name table is full.");
+	}
+
+	chars.append(name);
+	ends.push_back(static_cast<uint32_t>(chars.size()));
+
+	const NameId id = static_cast<NameId>(ends.size() - 1);
+	slots[slot] = id;
+	return id;
+}
+
+NameId NameTable::find(std::string_view name) const noexcept {
+	if (slots.empty()) return none;
+	return slots[slot_of(name)];
+}
+
+std::string_view NameTable::view(NameId id) const noexcept {
+	const size_t begin = id == 0 ? 0 : ends[id - 1];
+	return std::string_view(chars).substr(begin, ends[id] - begin);
+}
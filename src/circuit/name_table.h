@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+using NameId = uint32_t;
+
+// Interns the names of a circuit: every distinct name is stored once in one buffer and is referred to
+// by its 32-bit id, the ids are given out in order from 0. The lookup is an open addressing hash table
+// of ids, so a name costs its characters and 12 to 20 bytes however many there are, with no allocation per name.
+class NameTable {
+private:
+	static constexpr NameId empty_slot = UINT32_MAX;
+
+	// the characters of all names, ends[i] is the end of the name i, which starts at the end of the previous one
+	std::string chars;
+	std::vector<uint32_t> ends;
+
+	// the ids by the hash of their name, at most half full, the size is a power of two
+	std::vector<NameId> slots;
+
+	static uint32_t hash(std::string_view name) noexcept;
+	// the slot of the name, or the empty slot where it would go
+	size_t slot_of(std::string_view name) const noexcept;
+	void grow();
+
+public:
+	static constexpr NameId none = UINT32_MAX;
+
+	// the id of the name, which is added when it is not there yet, throws std::length_error when the table is full
+	NameId intern(std::string_view name);
+	// the id of the name or none
+	NameId find(std::string_view name) const noexcept;
+
+	// valid until the next name is added
+	std::string_view view(NameId id) const noexcept;
+
+	inline size_t size() const noexcept { return ends.size(); }
+};
+
+// the name of a part, its id in the name table of its circuit
+struct PartName {
+	const NameTable *table;
+	NameId id;
+
+	inline std::string_view view() const noexcept { return table->view(id); }
+};
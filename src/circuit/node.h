@@ -1,12 +1,16 @@
 #pragma once
 
 #include "scalar.h"
+#include "solution.h"
 
 #include <cstddef>
 
 
 struct Node {
-	scalar voltage = 0.0;
+	// the entry node_id of the solution, the ground is never bound
+	SolutionEntry solution;
 	size_t node_id = 0;
 	bool is_ground = false;
+
+	inline scalar voltage() const noexcept { return solution.get(); }
 };
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "circuit/checkpoint.h"
+#include "circuit/integration.h"
+#include "circuit/interpreter/quantity.h"
+#include "circuit/name_table.h"
 #include "circuit/node.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
+#include <complex>
+#include <format>
+#include <limits>
+#include <span>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -15,6 +24,20 @@ struct StampParams {
 	scalar timestep_inv;
 	size_t step;
 	scalar time;
+	IntegrationMethod method;
+
+	// The dc operating point analysis: capacitors are open, inductors are shorts and the sources
+	// are scaled by source_scale. The circuit adds the conductance gmin from every node to ground.
+	bool dc;
+	scalar gmin;
+	scalar source_scale;
+};
+
+// the error allowed in one adaptive step is relative * |value| + the absolute tolerance of the quantity
+struct ErrorTolerance {
+	scalar relative = 1e-3;
+	scalar voltage = 1e-6;
+	scalar current = 1e-9;
 };
 
 struct MatrixEntry {
@@ -23,6 +46,11 @@ struct MatrixEntry {
 	scalar value;
 };
 
+// the voltage of a node in the solution of the ac analysis
+inline complex_scalar ac_voltage(const Node *node, std::span<const complex_scalar> solution) noexcept {
+	return node->is_ground ? complex_scalar{} : solution[node->node_id];
+}
+
 
 class Part {
 public:
@@ -37,21 +65,85 @@ public:
 
 	virtual Pin pin(const std::string &pinname) = 0;
 	virtual ConstPin pin(const std::string &pinname) const = 0;
+	virtual std::string_view get_pin_name(size_t pin_id) const noexcept = 0;
 
 	virtual size_t num_needed_matrix_rows() const { return 0; };
 	virtual void set_first_matrix_row_id([[maybe_unused]] size_t first_row_id) {}
 	virtual size_t get_first_matrix_row_id() { return 0; };
 
-	virtual std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) = 0;
-	virtual void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) = 0;
+	// appends the entries to the list, the list is reused between steps so that stamping does not allocate
+	virtual void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) = 0;
+	virtual void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) = 0;
 
-	virtual const std::string &get_name() const = 0;
-	virtual void set_name(const std::string &name) = 0;
+	// the name is interned in the name table of the circuit, the view is valid until the next part is added
+	virtual std::string_view get_name() const = 0;
 
 	virtual scalar get_current_between(const ConstPin &a, const ConstPin &b) const = 0;
 
-	// i in range 0 .. num_needed_matrix_rows() - 1
-	virtual void update_value_from_result([[maybe_unused]] size_t i, [[maybe_unused]] scalar value) {}
+	// Points the part to the solution of the circuit, its rows from get_first_matrix_row_id() are read there after
+	// every solve (e.g. the current of a voltage source) instead of being copied out. Called whenever the circuit allocates the solution.
+	virtual void bind_solution([[maybe_unused]] std::span<const scalar> solution) {}
 
 	virtual void update([[maybe_unused]] const StampParams &params) {};
-};
\ No newline at end of file
+
+	// Changes the parameter of the given quantity (e.g. the resistance of a resistor), used by the parameter sweeps.
+	// Returns false when the part has no parameter of that quantity.
+	virtual bool set_parameter([[maybe_unused]] Quantity quantity, [[maybe_unused]] scalar value) { return false; }
+
+	// Restores the state the part had before the first step, the parameters stay as they are.
+	virtual void reset() {}
+
+	// The state the next fixed step starts from, e.g. the voltage of a capacitor, the periodic steady state
+	// analysis restarts a period from it. Discrete states (the mode of an op amp) are stored as a number.
+	virtual size_t state_size() const { return 0; }
+	virtual void save_state([[maybe_unused]] std::span<scalar> state) const {}
+	virtual void load_state([[maybe_unused]] std::span<const scalar> state) {}
+
+	// The complete state for a checkpoint, everything the following steps depend on, e.g. the step history
+	// of Gear-2 or the pending switch events, so that a restored run continues bit for bit. Defaults to the state above.
+	virtual void save_checkpoint(CheckpointWriter &out) const {
+		std::vector<scalar> state(state_size());
+		save_state(state);
+		out.write_scalars(state);
+	}
+	virtual void load_checkpoint(CheckpointReader &in) {
+		std::vector<scalar> state(state_size());
+		in.read_scalars(state);
+		load_state(state);
+	}
+
+	// Estimated local truncation error of the step just solved (before update) divided by the allowed error,
+	// the adaptive stepping accepts the step when no part returns more than 1. Parts without state return 0.
+	virtual scalar local_truncation_error([[maybe_unused]] const StampParams &params, [[maybe_unused]] const ErrorTolerance &tolerance) const { return 0.0; }
+
+	// The small-signal model of the ac analysis, linearized around the present state. At the angular frequency w
+	// the system is (conductance + j w susceptance) x = excitation. Parts without memory stamp the matrix
+	// of a step into the conductance, which is the default, capacitors and inductors stamp C and -L into the susceptance.
+	virtual void stamp_ac_entries(std::vector<MatrixEntry> &conductance, [[maybe_unused]] std::vector<MatrixEntry> &susceptance, const StampParams &params) {
+		stamp_matrix_entries(conductance, params);
+	}
+	// the phasors of the ac sources, the other sources are constant, so they are zero in the ac analysis
+	virtual void stamp_ac_excitation([[maybe_unused]] std::vector<complex_scalar> &rhs) const {}
+	// the counterpart of get_current_between for the solution of the ac analysis
+	virtual complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, [[maybe_unused]] std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const { return 0.0; }
+
+	// The next time the part changes abruptly, e.g. a scheduled switch, the adaptive stepping does not step over it.
+	virtual scalar next_breakpoint() const { return std::numeric_limits<scalar>::infinity(); }
+};
+
+inline std::string ConstPin::name() const {
+	return std::format("{}.{}", owner->get_name(), owner->get_pin_name(pin_id));
+}
+
+inline std::string Pin::name() const {
+	return ConstPin(*this).name();
+}
+
+
+// A part whose value can be set from outside the circuit, used as an input of the block processing API
+class DrivablePart {
+public:
+	virtual ~DrivablePart() = default;
+
+	virtual void drive(scalar value) = 0;
+};
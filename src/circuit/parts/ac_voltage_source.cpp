@@ -4,16 +4,17 @@
 
 #include <cassert>
 #include <cmath>
+#include <complex>
 #include <numbers>
 
 
 
-AcVoltageSource::AcVoltageSource(const std::string &name, scalar frequency, scalar amplitude, scalar phase) :
+AcVoltageSource::AcVoltageSource(PartName name, scalar frequency, scalar amplitude, scalar phase) :
 	NPinPart<1>(name),
 	amplitude(amplitude),
 	phase(phase),
-	branch_id(0),
-	current(0) {
+	sine(tau * frequency, phase),
+	branch_id(0) {
 
 	angular_vel = tau * frequency;
 	voltage = amplitude * std::sin(phase);
@@ -21,36 +22,74 @@ AcVoltageSource::AcVoltageSource(const std::string &name, scalar frequency, scal
 
 AcVoltageSource::~AcVoltageSource() {}
 
-std::vector<MatrixEntry> AcVoltageSource::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node = pin().node;
-	if (node->is_ground) return {};
+void AcVoltageSource::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	if (node0->is_ground) return;
 
-	return { {node->node_id, branch_id, 1.0}, {branch_id, node->node_id, 1.0} };
+	entries.push_back({ node0->node_id, branch_id, 1.0 });
+	entries.push_back({ branch_id, node0->node_id, 1.0 });
+}
+
+// the phasor of amplitude * sin(w t + phase)
+void AcVoltageSource::stamp_ac_excitation(std::vector<complex_scalar> &rhs) const {
+	if (num_needed_matrix_rows() == 0) return;
+
+	rhs[branch_id] += amplitude * std::polar<scalar>(1.0, phase);
 }
 
 scalar AcVoltageSource::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return current;
+	return current.get();
 }
 
-void AcVoltageSource::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
+void AcVoltageSource::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	voltage = params.source_scale * amplitude * sine.value(params.time, params.timestep);
+	// a grounded source has no row, branch_id is the row of the next part then
+	if (num_needed_matrix_rows() == 0) return;
+
 	rhs[branch_id] += voltage;
 }
 
-void AcVoltageSource::update_value_from_result([[maybe_unused]] size_t i, scalar value) {
-	current = value;
+bool AcVoltageSource::set_parameter(Quantity quantity, scalar value) {
+	switch (quantity) {
+		case Quantity::Frequency:
+			angular_vel = tau * value;
+			sine.set(angular_vel, phase);
+			return true;
+
+		case Quantity::Voltage:
+			amplitude = value;
+			break;
+
+		case Quantity::Angle:
+			phase = value;
+			break;
+
+		default:
+			return false;
+	}
+
+	sine.set(angular_vel, phase);
+	voltage = amplitude * std::sin(phase);
+	return true;
+}
+
+void AcVoltageSource::reset() {
+	voltage = amplitude * std::sin(phase);
+	sine.invalidate();
 }
 
-void AcVoltageSource::update(const StampParams &params) {
-	voltage = amplitude * std::sin(angular_vel * params.time + phase);
+scalar AcVoltageSource::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	const scalar wh = angular_vel * params.timestep;
+	return std::abs(amplitude) * wh * wh / 8.0 / (tolerance.voltage + tolerance.relative * std::abs(amplitude));
 }
 
 
-AcVoltageSource2Pin::AcVoltageSource2Pin(const std::string &name, scalar frequency, scalar amplitude, scalar phase) :
+AcVoltageSource2Pin::AcVoltageSource2Pin(PartName name, scalar frequency, scalar amplitude, scalar phase) :
 	NPinPart<2>(name),
 	amplitude(amplitude),
 	phase(phase),
-	branch_id(0),
-	current(0) {
+	sine(tau * frequency, phase),
+	branch_id(0) {
 
 	angular_vel = tau * frequency;
 	voltage = amplitude * std::sin(phase);
@@ -58,11 +97,9 @@ AcVoltageSource2Pin::AcVoltageSource2Pin(const std::string &name, scalar frequen
 
 AcVoltageSource2Pin::~AcVoltageSource2Pin() {}
 
-std::vector<MatrixEntry> AcVoltageSource2Pin::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
-
-	std::vector<MatrixEntry> entries;
+void AcVoltageSource2Pin::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground) {
 		entries.push_back({ node0->node_id, branch_id, 1.0 });
@@ -72,22 +109,52 @@ std::vector<MatrixEntry> AcVoltageSource2Pin::gen_matrix_entries([[maybe_unused]
 		entries.push_back({ node1->node_id, branch_id, -1.0 });
 		entries.push_back({ branch_id, node1->node_id, -1.0 });
 	}
-
-	return entries;
 }
 
-void AcVoltageSource2Pin::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
+void AcVoltageSource2Pin::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	voltage = params.source_scale * amplitude * sine.value(params.time, params.timestep);
 	rhs[branch_id] += voltage;
 }
 
+// the phasor of amplitude * sin(w t + phase)
+void AcVoltageSource2Pin::stamp_ac_excitation(std::vector<complex_scalar> &rhs) const {
+	rhs[branch_id] += amplitude * std::polar<scalar>(1.0, phase);
+}
+
 scalar AcVoltageSource2Pin::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return current;
+	return current.get();
 }
 
-void AcVoltageSource2Pin::update_value_from_result([[maybe_unused]] size_t i, scalar value) {
-	current = value;
+bool AcVoltageSource2Pin::set_parameter(Quantity quantity, scalar value) {
+	switch (quantity) {
+		case Quantity::Frequency:
+			angular_vel = tau * value;
+			sine.set(angular_vel, phase);
+			return true;
+
+		case Quantity::Voltage:
+			amplitude = value;
+			break;
+
+		case Quantity::Angle:
+			phase = value;
+			break;
+
+		default:
+			return false;
+	}
+
+	sine.set(angular_vel, phase);
+	voltage = amplitude * std::sin(phase);
+	return true;
+}
+
+void AcVoltageSource2Pin::reset() {
+	voltage = amplitude * std::sin(phase);
+	sine.invalidate();
 }
 
-void AcVoltageSource2Pin::update(const StampParams &params) {
-	voltage = amplitude * std::sin(angular_vel * params.time + phase);
+scalar AcVoltageSource2Pin::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	const scalar wh = angular_vel * params.timestep;
+	return std::abs(amplitude) * wh * wh / 8.0 / (tolerance.voltage + tolerance.relative * std::abs(amplitude));
 }
\ No newline at end of file
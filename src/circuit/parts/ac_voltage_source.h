@@ -2,11 +2,14 @@
 
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
+#include "circuit/solution.h"
+#include "dsp/sine_generator.h"
 
-#include <string>
+#include <span>
 
 
 class AcVoltageSource : public NPinPart<1> {
@@ -16,25 +19,44 @@ private:
 	scalar phase;
 
 	scalar voltage;
+	SineGenerator sine;
 
 	size_t branch_id;
-	scalar current;
+	SolutionEntry current;
 
 public:
-	AcVoltageSource(const std::string &name, scalar frequency, scalar amplitude, scalar phase = 0.0);
+	AcVoltageSource(PartName name, scalar frequency, scalar amplitude, scalar phase = 0.0);
 	~AcVoltageSource() noexcept;
 
-	size_t num_needed_matrix_rows() const override { return pin().node->is_ground ? 0 : 1; }
+	size_t num_needed_matrix_rows() const override { return node(0)->is_ground ? 0 : 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	// evaluates the sine at the time of the step, from a block generated ahead while the steps are uniform
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
+	void stamp_ac_excitation(std::vector<complex_scalar> &rhs) const override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
 
-	void update_value_from_result(size_t i, scalar value) override;
-	void update(const StampParams &params) override;
+	// the current is the row of the source in the solution, a grounded source has none and reads 0
+	void bind_solution(std::span<const scalar> solution) override {
+		if (num_needed_matrix_rows() > 0) current.bind(solution, branch_id);
+		else current.unbind();
+	}
+
+	// frequency, amplitude (voltage) or phase (angle)
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	void reset() override;
+
+	// the position of the sine generator
+	void save_checkpoint(CheckpointWriter &out) const override { sine.save_checkpoint(out); }
+	void load_checkpoint(CheckpointReader &in) override { sine.load_checkpoint(in); }
+
+	// the error of following the sine by straight segments
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
 };
 
 
@@ -45,24 +67,39 @@ private:
 	scalar phase;
 
 	scalar voltage;
+	SineGenerator sine;
 	size_t branch_id;
 
-	scalar current;
+	SolutionEntry current;
 
 public:
-	AcVoltageSource2Pin(const std::string &name, scalar frequency, scalar amplitude, scalar phase = 0.0);
+	AcVoltageSource2Pin(PartName name, scalar frequency, scalar amplitude, scalar phase = 0.0);
 	~AcVoltageSource2Pin() noexcept;
 
 	size_t num_needed_matrix_rows() const override { return 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	// evaluates the sine at the time of the step, from a block generated ahead while the steps are uniform
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
+	void stamp_ac_excitation(std::vector<complex_scalar> &rhs) const override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
+
+	// the current is the row of the source in the solution
+	void bind_solution(std::span<const scalar> solution) override { current.bind(solution, branch_id); }
+
+	// frequency, amplitude (voltage) or phase (angle)
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	void reset() override;
 
-	void update_value_from_result(size_t i, scalar value) override;
+	// the position of the sine generator
+	void save_checkpoint(CheckpointWriter &out) const override { sine.save_checkpoint(out); }
+	void load_checkpoint(CheckpointReader &in) override { sine.load_checkpoint(in); }
 
-	void update(const StampParams &params) override;
+	// the error of following the sine by straight segments
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
 };
\ No newline at end of file
@@ -1,30 +1,41 @@
 #include "circuit/parts/capacitor.h"
 
+#include "circuit/integration.h"
 #include "circuit/n_pin_part.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
+#include <algorithm>
+#include <cmath>
+#include <span>
 #include <string>
 
 
 
-Capacitor::Capacitor(const std::string &name, scalar capacitance) :
+Capacitor::Capacitor(PartName name, scalar capacitance) :
 	NPinPart<2>(name),
 	capacitance(capacitance),
-	last_v(0.0),
 	last_i(0.0),
-	admittance(0.0) {
+	admittance(0.0),
+	history_current(0.0) {
 }
 
 
-std::vector<MatrixEntry> Capacitor::gen_matrix_entries(const StampParams &params) {
-	admittance = capacitance * params.timestep_inv;
-
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
+void Capacitor::stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) {
+	if (params.dc) {
+		// open, the entries stay so that the pattern matches the transient one
+		admittance = 0.0;
+		history_current = 0.0;
+	}
+	else {
+		const auto [a0, a1, a2, b1] = derivative_coefficients(params.method, history, params.timestep);
+		admittance = capacitance * a0;
+		history_current = capacitance * (a1 * history.values[0] + a2 * history.values[1]) + b1 * last_i;
+	}
 
-	std::vector<MatrixEntry> entries;
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground && !node1->is_ground) {
 		entries.push_back({ node0->node_id, node0->node_id, admittance });
@@ -38,27 +49,93 @@ std::vector<MatrixEntry> Capacitor::gen_matrix_entries(const StampParams &params
 	else if (!node1->is_ground) {
 		entries.push_back({ node1->node_id, node1->node_id, admittance });
 	}
-
-	return entries;
 }
 
-void Capacitor::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
+void Capacitor::stamp_rhs_entries(std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
-	auto value = admittance * last_v;
+	auto value = -history_current;
 
 	if (!node0->is_ground) rhs[node0->node_id] += value;
 	if (!node1->is_ground) rhs[node1->node_id] += -value;
 }
 
-void Capacitor::update([[maybe_unused]] const StampParams &params) {
-	scalar v_now = pin(0).node->voltage - pin(1).node->voltage;
-	last_i = admittance * (v_now - last_v);
-	last_v = v_now;
+void Capacitor::update(const StampParams &params) {
+	scalar v_now = node(0)->voltage() - node(1)->voltage();
+	last_i = admittance * v_now + history_current;
+
+	// the operating point is the initial condition, the voltage has been constant before it
+	if (params.dc) history.clear(v_now);
+	else history.push(v_now, params.timestep);
+}
+
+scalar Capacitor::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	scalar v_now = node(0)->voltage() - node(1)->voltage();
+	scalar error = truncation_error(params.method, history, v_now, params.timestep);
+
+	return error / (tolerance.voltage + tolerance.relative * std::max(std::abs(v_now), std::abs(history.values[0])));
+}
+
+void Capacitor::save_state(std::span<scalar> state) const {
+	state[0] = history.values[0];
+	state[1] = history.values[1];
+	state[2] = last_i;
+}
+
+void Capacitor::load_state(std::span<const scalar> state) {
+	history.values[0] = state[0];
+	history.values[1] = state[1];
+	last_i = state[2];
+}
+
+void Capacitor::save_checkpoint(CheckpointWriter &out) const {
+	history.save_checkpoint(out);
+	out.write_scalar(last_i);
+}
+
+void Capacitor::load_checkpoint(CheckpointReader &in) {
+	history.load_checkpoint(in);
+	last_i = in.read_scalar();
 }
 
+void Capacitor::reset() {
+	last_i = 0.0;
+	admittance = 0.0;
+	history_current = 0.0;
+	history.clear();
+}
+
+
+void Capacitor::stamp_ac_entries([[maybe_unused]] std::vector<MatrixEntry> &conductance, std::vector<MatrixEntry> &susceptance, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
+
+	if (!node0->is_ground && !node1->is_ground) {
+		susceptance.push_back({ node0->node_id, node0->node_id, capacitance });
+		susceptance.push_back({ node0->node_id, node1->node_id, -capacitance });
+		susceptance.push_back({ node1->node_id, node0->node_id, -capacitance });
+		susceptance.push_back({ node1->node_id, node1->node_id, capacitance });
+	}
+	else if (!node0->is_ground) {
+		susceptance.push_back({ node0->node_id, node0->node_id, capacitance });
+	}
+	else if (!node1->is_ground) {
+		susceptance.push_back({ node1->node_id, node1->node_id, capacitance });
+	}
+}
+
+complex_scalar Capacitor::get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, scalar omega) const {
+	return complex_scalar(0.0, omega * capacitance) * (ac_voltage(node(0), solution) - ac_voltage(node(1), solution));
+}
 
 scalar Capacitor::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
 	return last_i;
+}
+
+bool Capacitor::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Capacitance) return false;
+
+	capacitance = value;
+	return true;
 }
\ No newline at end of file
@@ -1,28 +1,52 @@
 #pragma once
 
+#include "circuit/integration.h"
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
-#include <string>
+#include <span>
 
 
 class Capacitor : public NPinPart<2> {
 private:
 	scalar capacitance;
-	scalar last_v;
 	scalar last_i;
+
+	// companion model of the step, i = admittance * v + history_current
 	scalar admittance;
+	scalar history_current;
+
+	// the committed voltages
+	IntegrationHistory history;
 
 public:
-	Capacitor(const std::string &name, scalar capacitance);
+	Capacitor(PartName name, scalar capacitance);
 	~Capacitor() noexcept = default;
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
 
+	void stamp_ac_entries(std::vector<MatrixEntry> &conductance, std::vector<MatrixEntry> &susceptance, const StampParams &params) override;
+	complex_scalar get_ac_current_between(const ConstPin &a, const ConstPin &b, std::span<const complex_scalar> solution, scalar omega) const override;
+
 	void update(const StampParams &params) override;
+
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	void reset() override;
+
+	// the last two committed values and the last current
+	size_t state_size() const override { return 3; }
+	void save_state(std::span<scalar> state) const override;
+	void load_state(std::span<const scalar> state) override;
+	// the history with its steps, for Gear-2 after variable steps
+	void save_checkpoint(CheckpointWriter &out) const override;
+	void load_checkpoint(CheckpointReader &in) override;
+
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
 };
\ No newline at end of file
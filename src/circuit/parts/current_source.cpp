@@ -8,20 +8,28 @@
 #include <string>
 
 
-CurrentSource::CurrentSource(const std::string &name, scalar current) :
+CurrentSource::CurrentSource(PartName name, scalar current) :
 	NPinPart<2>(name),
 	current(current) {
 }
 
-void CurrentSource::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
+void CurrentSource::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
-	if (!node0->is_ground) rhs[node0->node_id] += -current;
-	if (!node1->is_ground) rhs[node1->node_id] += current;
+	const scalar value = params.source_scale * current;
+
+	if (!node0->is_ground) rhs[node0->node_id] += -value;
+	if (!node1->is_ground) rhs[node1->node_id] += value;
 }
 
 scalar CurrentSource::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
 	return current;
 }
 
+bool CurrentSource::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Current) return false;
+
+	current = value;
+	return true;
+}
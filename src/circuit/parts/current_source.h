@@ -1,23 +1,28 @@
 #pragma once
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
-#include <string>
+#include <span>
 
 
-class CurrentSource : public NPinPart<2> {
+class CurrentSource : public NPinPart<2>, public DrivablePart {
 private:
 	scalar current;
 
 public:
-	CurrentSource(const std::string &name, scalar current);
+	CurrentSource(PartName name, scalar current);
 	~CurrentSource() noexcept = default;
 
-	std::vector<MatrixEntry> gen_matrix_entries([[maybe_unused]] const StampParams &params) override { return {}; }
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries([[maybe_unused]] std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) override {}
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+
+	void drive(scalar value) override { current = value; }
+
+	bool set_parameter(Quantity quantity, scalar value) override;
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "circuit/parts/file_voltage_source.h"
+
+#include "dsp/sample_file.h"
+
+#include <cmath>
+
+
+// half of the second difference over the step, the distance of the middle of the recording from the straight segment
+static scalar straight_segment_error(const SampleFile &samples, scalar gain, const StampParams &params, const ErrorTolerance &tolerance) {
+	const scalar h = params.timestep;
+	const scalar v0 = gain * samples.value(params.time - h, 0.0);
+	const scalar v1 = gain * samples.value(params.time - 0.5 * h, 0.0);
+	const scalar v2 = gain * samples.value(params.time, 0.0);
+
+	const scalar error = 0.5 * std::abs(v0 - 2.0 * v1 + v2);
+	return error / (tolerance.voltage + tolerance.relative * std::abs(v2));
+}
+
+
+FileVoltageSource::FileVoltageSource(PartName name, const fs::path &path, scalar gain, scalar sample_rate) :
+	NPinPart<1>(name),
+	samples(path, sample_rate),
+	gain(gain),
+	voltage(0.0),
+	branch_id(0) {
+}
+
+FileVoltageSource::~FileVoltageSource() {}
+
+void FileVoltageSource::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	if (node0->is_ground) return;
+
+	entries.push_back({ node0->node_id, branch_id, 1.0 });
+	entries.push_back({ branch_id, node0->node_id, 1.0 });
+}
+
+void FileVoltageSource::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	voltage = params.source_scale * gain * samples.value(params.time, params.timestep);
+	// a grounded source has no row, branch_id is the row of the next part then
+	if (num_needed_matrix_rows() == 0) return;
+
+	rhs[branch_id] += voltage;
+}
+
+scalar FileVoltageSource::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
+	return current.get();
+}
+
+bool FileVoltageSource::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Voltage) return false;
+
+	gain = value;
+	return true;
+}
+
+scalar FileVoltageSource::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	return straight_segment_error(samples, gain, params, tolerance);
+}
+
+
+FileVoltageSource2Pin::FileVoltageSource2Pin(PartName name, const fs::path &path, scalar gain, scalar sample_rate) :
+	NPinPart<2>(name),
+	samples(path, sample_rate),
+	gain(gain),
+	voltage(0.0),
+	branch_id(0) {
+}
+
+FileVoltageSource2Pin::~FileVoltageSource2Pin() {}
+
+void FileVoltageSource2Pin::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
+
+	if (!node0->is_ground) {
+		entries.push_back({ node0->node_id, branch_id, 1.0 });
+		entries.push_back({ branch_id, node0->node_id, 1.0 });
+	}
+	if (!node1->is_ground) {
+		entries.push_back({ node1->node_id, branch_id, -1.0 });
+		entries.push_back({ branch_id, node1->node_id, -1.0 });
+	}
+}
+
+void FileVoltageSource2Pin::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	voltage = params.source_scale * gain * samples.value(params.time, params.timestep);
+	rhs[branch_id] += voltage;
+}
+
+scalar FileVoltageSource2Pin::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
+	return current.get();
+}
+
+bool FileVoltageSource2Pin::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Voltage) return false;
+
+	gain = value;
+	return true;
+}
+
+scalar FileVoltageSource2Pin::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	return straight_segment_error(samples, gain, params, tolerance);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
+#include "circuit/part.h"
+#include "circuit/pin.h"
+#include "circuit/scalar.h"
+#include "circuit/solution.h"
+#include "dsp/sample_file.h"
+
+#include <filesystem>
+#include <span>
+
+
+namespace fs = std::filesystem;
+
+
+// A voltage source playing a recording from a WAV or raw float file, a full scale sample is the voltage gain.
+// The file is memory-mapped and resampled to the steps as they come, see SampleFile, it is silent after its end.
+class FileVoltageSource : public NPinPart<1> {
+private:
+	SampleFile samples;
+	scalar gain;
+
+	scalar voltage;
+	size_t branch_id;
+
+	SolutionEntry current;
+
+public:
+	// sample_rate is needed by raw files only, 0 takes the rate of the WAV file
+	FileVoltageSource(PartName name, const fs::path &path, scalar gain = 1.0, scalar sample_rate = 0.0);
+	~FileVoltageSource() noexcept;
+
+	size_t num_needed_matrix_rows() const override { return node(0)->is_ground ? 0 : 1; }
+	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
+	size_t get_first_matrix_row_id() override { return branch_id; }
+
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	// evaluates the recording at the time of the step
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
+
+	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
+
+	// the current is the row of the source in the solution, a grounded source has none and reads 0
+	void bind_solution(std::span<const scalar> solution) override {
+		if (num_needed_matrix_rows() > 0) current.bind(solution, branch_id);
+		else current.unbind();
+	}
+
+	// the gain (voltage)
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	// the error of following the recording by straight segments
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
+};
+
+
+class FileVoltageSource2Pin : public NPinPart<2> {
+private:
+	SampleFile samples;
+	scalar gain;
+
+	scalar voltage;
+	size_t branch_id;
+
+	SolutionEntry current;
+
+public:
+	// sample_rate is needed by raw files only, 0 takes the rate of the WAV file
+	FileVoltageSource2Pin(PartName name, const fs::path &path, scalar gain = 1.0, scalar sample_rate = 0.0);
+	~FileVoltageSource2Pin() noexcept;
+
+	size_t num_needed_matrix_rows() const override { return 1; }
+	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
+	size_t get_first_matrix_row_id() override { return branch_id; }
+
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	// evaluates the recording at the time of the step
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
+
+	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
+
+	// the current is the row of the source in the solution
+	void bind_solution(std::span<const scalar> solution) override { current.bind(solution, branch_id); }
+
+	// the gain (voltage)
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	// the error of following the recording by straight segments
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
+};
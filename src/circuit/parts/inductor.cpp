@@ -4,25 +4,39 @@
 #include "../part.h"
 #include "../pin.h"
 #include "../scalar.h"
+#include "circuit/integration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
 #include <string>
 
 
-Inductor::Inductor(const std::string &name, scalar inductance) :
+Inductor::Inductor(PartName name, scalar inductance) :
 	NPinPart<2>(name),
 	inductance(inductance),
-	last_i(0.0),
-	branch_id(0) {
+	branch_id(0),
+	resistance(0.0),
+	history_voltage(0.0),
+	last_v(0.0) {
 }
 
-std::vector<MatrixEntry> Inductor::gen_matrix_entries(const StampParams &params) {
-	const scalar req = inductance * params.timestep_inv;
-
-	std::vector<MatrixEntry> entries;
+void Inductor::stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) {
+	if (params.dc) {
+		// short, v = 0 on the branch row
+		resistance = 0.0;
+		history_voltage = 0.0;
+	}
+	else {
+		const auto [a0, a1, a2, b1] = derivative_coefficients(params.method, history, params.timestep);
+		resistance = inductance * a0;
+		history_voltage = inductance * (a1 * history.values[0] + a2 * history.values[1]) + b1 * last_v;
+	}
 
-	entries.push_back({ branch_id, branch_id, -req });
+	entries.push_back({ branch_id, branch_id, -resistance });
 
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground) {
 		entries.push_back({ node0->node_id, branch_id, 1.0 });
@@ -32,15 +46,79 @@ std::vector<MatrixEntry> Inductor::gen_matrix_entries(const StampParams &params)
 		entries.push_back({ node1->node_id, branch_id, -1.0 });
 		entries.push_back({ branch_id, node1->node_id, -1.0 });
 	}
+}
+
+void Inductor::stamp_rhs_entries(std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) {
+	rhs[branch_id] += history_voltage;
+}
+
+void Inductor::stamp_ac_entries(std::vector<MatrixEntry> &conductance, std::vector<MatrixEntry> &susceptance, [[maybe_unused]] const StampParams &params) {
+	// v = j w L i on the branch row
+	susceptance.push_back({ branch_id, branch_id, -inductance });
+
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
+
+	if (!node0->is_ground) {
+		conductance.push_back({ node0->node_id, branch_id, 1.0 });
+		conductance.push_back({ branch_id, node0->node_id, 1.0 });
+	}
+	if (!node1->is_ground) {
+		conductance.push_back({ node1->node_id, branch_id, -1.0 });
+		conductance.push_back({ branch_id, node1->node_id, -1.0 });
+	}
+}
 
-	return entries;
+void Inductor::update(const StampParams &params) {
+	last_v = node(0)->voltage() - node(1)->voltage();
+
+	// the operating point is the initial condition, the current has been constant before it
+	if (params.dc) history.clear(pending_i.get());
+	else history.push(pending_i.get(), params.timestep);
+}
+
+scalar Inductor::local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const {
+	scalar error = truncation_error(params.method, history, pending_i.get(), params.timestep);
+
+	return error / (tolerance.current + tolerance.relative * std::max(std::abs(pending_i.get()), std::abs(history.values[0])));
+}
+
+void Inductor::save_state(std::span<scalar> state) const {
+	state[0] = history.values[0];
+	state[1] = history.values[1];
+	state[2] = last_v;
+}
+
+void Inductor::load_state(std::span<const scalar> state) {
+	history.values[0] = state[0];
+	history.values[1] = state[1];
+	last_v = state[2];
 }
 
-void Inductor::stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) {
-	const scalar req = inductance * params.timestep_inv;
-	rhs[branch_id] += -req * last_i;
+void Inductor::save_checkpoint(CheckpointWriter &out) const {
+	history.save_checkpoint(out);
+	out.write_scalar(last_v);
+}
+
+void Inductor::load_checkpoint(CheckpointReader &in) {
+	history.load_checkpoint(in);
+	last_v = in.read_scalar();
+}
+
+void Inductor::reset() {
+	resistance = 0.0;
+	history_voltage = 0.0;
+	last_v = 0.0;
+	history.clear();
 }
 
 scalar Inductor::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return last_i;
+	return history.values[0];
+}
+
+bool Inductor::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Inductance) return false;
+
+	inductance = value;
+	return true;
 }
\ No newline at end of file
@@ -1,31 +1,63 @@
 #pragma once
 
+#include "circuit/integration.h"
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
+#include "circuit/solution.h"
 
-#include <string>
+#include <span>
 
 
 class Inductor : public NPinPart<2> {
 private:
 	scalar inductance;
-	scalar last_i;
 	size_t branch_id;
 
+	// companion model of the step, v = resistance * i + history_voltage
+	scalar resistance;
+	scalar history_voltage;
+
+	// the solved current, the row of the inductor in the solution, update() commits it so that a rejected adaptive step keeps the history
+	SolutionEntry pending_i;
+	scalar last_v;
+
+	// the committed currents
+	IntegrationHistory history;
+
 public:
-	Inductor(const std::string &name, scalar inductance);
+	Inductor(PartName name, scalar inductance);
 	~Inductor() noexcept = default;
 
 	size_t num_needed_matrix_rows() const override { return 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
+
+	void bind_solution(std::span<const scalar> solution) override { pending_i.bind(solution, branch_id); }
+
+	void update(const StampParams &params) override;
+
+	void stamp_ac_entries(std::vector<MatrixEntry> &conductance, std::vector<MatrixEntry> &susceptance, const StampParams &params) override;
+
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	void reset() override;
+
+	// the last two committed values and the last voltage
+	size_t state_size() const override { return 3; }
+	void save_state(std::span<scalar> state) const override;
+	void load_state(std::span<const scalar> state) override;
+	// the history with its steps, for Gear-2 after variable steps
+	void save_checkpoint(CheckpointWriter &out) const override;
+	void load_checkpoint(CheckpointReader &in) override;
 
-	void update_value_from_result([[maybe_unused]] size_t i, scalar value) override { last_i = value; }
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
 };
\ No newline at end of file
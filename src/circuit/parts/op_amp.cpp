@@ -2,8 +2,12 @@
 
 #include "circuit/util.h"
 
+#include <algorithm>
+#include <cmath>
+#include <span>
 
-OpAmp::OpAmp(const std::string &name, scalar v_min, scalar v_max, scalar amplification) :
+
+OpAmp::OpAmp(PartName name, scalar v_min, scalar v_max, scalar amplification) :
 	NPinPart<3>(name),
 	v_min(v_min),
 	v_max(v_max),
@@ -12,17 +16,15 @@ OpAmp::OpAmp(const std::string &name, scalar v_min, scalar v_max, scalar amplifi
 	mode(Mode::Linear) {
 }
 
-std::vector<MatrixEntry> OpAmp::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node = pin(Pins::Out).node;
-	if (node->is_ground) return {};
-
-	const auto &node_plus = pin(Pins::Plus).node;
-	const auto &node_minus = pin(Pins::Minus).node;
+void OpAmp::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node_out = node(Pins::Out);
+	if (node_out->is_ground) return;
 
-	std::vector<MatrixEntry> entries;
+	const auto &node_plus = node(Pins::Plus);
+	const auto &node_minus = node(Pins::Minus);
 
-	entries.push_back({ node->node_id, branch_id, 1.0 });
-	entries.push_back({ branch_id, node->node_id, 1.0 });
+	entries.push_back({ node_out->node_id, branch_id, 1.0 });
+	entries.push_back({ branch_id, node_out->node_id, 1.0 });
 
 	switch (mode) {
 		case Mode::Linear:
@@ -37,11 +39,9 @@ std::vector<MatrixEntry> OpAmp::gen_matrix_entries([[maybe_unused]] const StampP
 		default:
 			break;
 	}
-
-	return entries;
 }
 
-void OpAmp::stamp_rhs_entries([[maybe_unused]] std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
+void OpAmp::stamp_rhs_entries([[maybe_unused]] std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) {
 	switch (mode) {
 		case Mode::SatHigh:
 			rhs[branch_id] += v_max;
@@ -57,10 +57,10 @@ void OpAmp::stamp_rhs_entries([[maybe_unused]] std::vector<scalar> &rhs, [[maybe
 }
 
 void OpAmp::update([[maybe_unused]] const StampParams &params) {
-	const auto &node_plus = pin(Pins::Plus).node;
-	const auto &node_minus = pin(Pins::Minus).node;
+	const auto &node_plus = node(Pins::Plus);
+	const auto &node_minus = node(Pins::Minus);
 
-	scalar diff = amplification * (node_plus->voltage - node_minus->voltage);
+	scalar diff = amplification * (node_plus->voltage() - node_minus->voltage());
 
 	switch (mode) {
 		case Mode::Linear:
@@ -77,3 +77,39 @@ void OpAmp::update([[maybe_unused]] const StampParams &params) {
 			break;
 	}
 }
+
+scalar OpAmp::local_truncation_error([[maybe_unused]] const StampParams &params, const ErrorTolerance &tolerance) const {
+	const auto &node_plus = node(Pins::Plus);
+	const auto &node_minus = node(Pins::Minus);
+
+	scalar diff = amplification * (node_plus->voltage() - node_minus->voltage());
+	scalar overshoot = 0.0;
+
+	switch (mode) {
+		case Mode::Linear:
+			overshoot = std::max<scalar>({ diff - (v_max + hysteresis), (v_min - hysteresis) - diff, 0.0 });
+			break;
+
+		case Mode::SatHigh:
+			overshoot = std::max<scalar>((v_max - hysteresis) - diff, 0.0);
+			break;
+
+		case Mode::SatLow:
+			overshoot = std::max<scalar>(diff - (v_min + hysteresis), 0.0);
+			break;
+	}
+
+	return overshoot / (tolerance.voltage + tolerance.relative * std::max(std::abs(v_min), std::abs(v_max)));
+}
+
+void OpAmp::load_state(std::span<const scalar> state) {
+	// the analysis may move the number slightly off the mode
+	mode = static_cast<Mode>(std::clamp<long>(std::lround(state[0]), 0, 2));
+}
+
+bool OpAmp::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::None) return false;
+
+	amplification = value;
+	return true;
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
+#include <span>
 #include <string>
 
 
@@ -46,21 +48,41 @@ public:
 		return pin(static_cast<size_t>(p));
 	}
 
+	using NPinPart<3>::node;
+
+	Node *node(const Pins &p) const noexcept {
+		return node(static_cast<size_t>(p));
+	}
+
 	std::string_view get_pin_name(size_t pin_id) const noexcept override {
 		return pin_names[pin_id];
 	}
 
-	OpAmp(const std::string &name, scalar v_min, scalar v_max, scalar amplification);
+	OpAmp(PartName name, scalar v_min, scalar v_max, scalar amplification);
 	~OpAmp() noexcept = default;
 
 	size_t num_needed_matrix_rows() const override { return 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries([[maybe_unused]] std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries([[maybe_unused]] std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) override;
 
 	void update(const StampParams &params) override;
 
+	// the amplification has no unit, so it is set with the quantity none
+	bool set_parameter(Quantity quantity, scalar value) override;
+
+	void reset() override { mode = Mode::Linear; }
+
+	// the mode
+	size_t state_size() const override { return 1; }
+	void save_state(std::span<scalar> state) const override { state[0] = static_cast<scalar>(mode); }
+	void load_state(std::span<const scalar> state) override;
+
+	// how far the output overshot the threshold of a mode change within the step,
+	// so the adaptive stepping narrows down the moment of the change
+	scalar local_truncation_error(const StampParams &params, const ErrorTolerance &tolerance) const override;
+
 	scalar get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const override { return 0.0; }
 };
\ No newline at end of file
@@ -1,15 +1,13 @@
 #include "circuit/parts/resistor.h"
 
 
-Resistor::Resistor(const std::string &name, scalar ohms) : NPinPart<2>(name), ohms(ohms) {
+Resistor::Resistor(PartName name, scalar ohms) : NPinPart<2>(name), ohms(ohms) {
 	conductance = 1.0f / ohms;
 }
 
-std::vector<MatrixEntry> Resistor::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
-
-	std::vector<MatrixEntry> entries;
+void Resistor::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground && !node1->is_ground) {
 		entries.push_back({ node0->node_id, node0->node_id, conductance });
@@ -23,13 +21,19 @@ std::vector<MatrixEntry> Resistor::gen_matrix_entries([[maybe_unused]] const Sta
 	else if (!node1->is_ground) {
 		entries.push_back({ node1->node_id, node1->node_id, conductance });
 	}
+}
 
-	return entries;
+bool Resistor::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Resistance) return false;
+
+	ohms = value;
+	conductance = 1.0f / ohms;
+	return true;
 }
 
 scalar Resistor::get_current_between(const ConstPin &a, const ConstPin &b) const {
 	if (a.owner != this || b.owner != this) {
 		throw std::runtime_error("Pins a and b must belong to this part.");
 	}
-	return conductance * (a.node->voltage - b.node->voltage);
+	return conductance * (a.node->voltage() - b.node->voltage());
 }
\ No newline at end of file
@@ -1,11 +1,12 @@
 #pragma once
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
 
-#include <string>
+#include <span>
 
 
 class Resistor : public NPinPart<2> {
@@ -14,11 +15,16 @@ private:
 	scalar conductance;
 
 public:
-	Resistor(const std::string &name, scalar ohms);
+	Resistor(PartName name, scalar ohms);
 	~Resistor() noexcept = default;
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries([[maybe_unused]] std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) override {}
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries([[maybe_unused]] std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) override {}
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between(const ConstPin &a, const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override {
+		return conductance * (ac_voltage(a.node, solution) - ac_voltage(b.node, solution));
+	}
+
+	bool set_parameter(Quantity quantity, scalar value) override;
 };
\ No newline at end of file
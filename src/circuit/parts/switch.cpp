@@ -1,17 +1,17 @@
 #include "circuit/parts/switch.h"
 
+#include <limits>
 
-Switch::Switch(const std::string &name, bool on) : NPinPart<2>(name), branch_id(0), last_i(0.0), on(on) {}
 
-std::vector<MatrixEntry> Switch::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const scalar req = on ? on_resistance : off_resistance;
+Switch::Switch(PartName name, bool on) : NPinPart<2>(name), branch_id(0), on(on), initially_on(on) {}
 
-	std::vector<MatrixEntry> entries;
+void Switch::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const scalar req = on ? on_resistance : off_resistance;
 
 	entries.push_back({ branch_id, branch_id, -req });
 
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground) {
 		entries.push_back({ node0->node_id, branch_id, 1.0 });
@@ -21,14 +21,19 @@ std::vector<MatrixEntry> Switch::gen_matrix_entries([[maybe_unused]] const Stamp
 		entries.push_back({ node1->node_id, branch_id, -1.0 });
 		entries.push_back({ branch_id, node1->node_id, -1.0 });
 	}
-
-	return entries;
 }
 
 void Switch::update(const StampParams &params) {
+	// the operating point is solved in the initial state, the events happen during the transient
+	if (params.dc) return;
+
 	bool new_on = on;
 
-	while (!events.empty() && events.top().step <= params.step) {
+	// the switch changes after the first solution at or past the time of the event,
+	// the small tolerance keeps the events on the exact time of a step from being postponed by rounding
+	const scalar now = params.time + params.timestep * 1e-9;
+
+	while (!events.empty() && events.top().time <= now) {
 		new_on = events.top().type == EventType::ON;
 		events.pop();
 	}
@@ -37,13 +42,50 @@ void Switch::update(const StampParams &params) {
 }
 
 scalar Switch::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return last_i;
+	return current.get();
 }
 
-void Switch::schedule_on(size_t step) {
-	events.push({ .step = step, .type = EventType::ON });
+void Switch::schedule_on(scalar time) {
+	schedule.push_back({ .time = time, .type = EventType::ON });
+	events.push(schedule.back());
 }
 
-void Switch::schedule_off(size_t step) {
-	events.push({ .step = step, .type = EventType::OFF });
+void Switch::schedule_off(scalar time) {
+	schedule.push_back({ .time = time, .type = EventType::OFF });
+	events.push(schedule.back());
+}
+
+scalar Switch::next_breakpoint() const {
+	return events.empty() ? std::numeric_limits<scalar>::infinity() : events.top().time;
+}
+
+void Switch::reset() {
+	on = initially_on;
+
+	events = {};
+	for (const Event &event : schedule) {
+		events.push(event);
+	}
+}
+
+void Switch::save_checkpoint(CheckpointWriter &out) const {
+	out.write_bool(on);
+
+	auto pending = events;
+	out.write_size(pending.size());
+	for (; !pending.empty(); pending.pop()) {
+		out.write_scalar(pending.top().time);
+		out.write_bool(pending.top().type == EventType::ON);
+	}
+}
+
+void Switch::load_checkpoint(CheckpointReader &in) {
+	on = in.read_bool();
+
+	events = {};
+	const size_t count = in.read_size();
+	for (size_t i = 0; i < count; ++i) {
+		const scalar time = in.read_scalar();
+		events.push({ .time = time, .type = in.read_bool() ? EventType::ON : EventType::OFF });
+	}
 }
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
+#include "circuit/solution.h"
 
 #include <queue>
-#include <string>
+#include <span>
 #include <vector>
 
 
@@ -16,9 +18,11 @@ private:
 	const scalar on_resistance = 1_m;
 
 	size_t branch_id;
-	scalar last_i;
+	// the current is the row of the switch in the solution
+	SolutionEntry current;
 
 	bool on;
+	bool initially_on;
 
 	enum class EventType {
 		ON,
@@ -26,39 +30,52 @@ private:
 	};
 
 	struct Event {
-		size_t step;
+		scalar time;
 		EventType type;
 	};
 
 	struct Comp {
 		bool operator()(const Event &a, const Event &b) const noexcept {
-			if (a.step != b.step) return a.step > b.step;
+			if (a.time != b.time) return a.time > b.time;
 			return a.type == EventType::OFF && b.type == EventType::ON;
 		}
 	};
 
 	std::priority_queue<Event, std::vector<Event>, Comp> events;
+	// all scheduled events, reset() enqueues them again
+	std::vector<Event> schedule;
 
 public:
-	Switch(const std::string &name, bool on = false);
+	Switch(PartName name, bool on = false);
 	~Switch() noexcept = default;
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries([[maybe_unused]] std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) override {}
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries([[maybe_unused]] std::span<scalar> rhs, [[maybe_unused]] const StampParams &params) override {}
 
 	void update(const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
 
 	void switch_on() { on = true; }
 	void switch_off() { on = false; }
 
-	void schedule_on(size_t step);
-	void schedule_off(size_t step);
+	// the event takes effect after the step that ends at or after the time
+	void schedule_on(scalar time);
+	void schedule_off(scalar time);
+
+	// the time of the next scheduled event, the adaptive stepping lands a step exactly on it
+	scalar next_breakpoint() const override;
 
 	size_t num_needed_matrix_rows() const override { return 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	void update_value_from_result([[maybe_unused]] size_t i, scalar value) override { last_i = value; }
+	void bind_solution(std::span<const scalar> solution) override { current.bind(solution, branch_id); }
+
+	void reset() override;
+
+	// the state and the events that did not happen yet
+	void save_checkpoint(CheckpointWriter &out) const override;
+	void load_checkpoint(CheckpointReader &in) override;
 };
\ No newline at end of file
@@ -3,40 +3,45 @@
 #include <cassert>
 
 
-VoltageSource::VoltageSource(const std::string &name, scalar voltage) : NPinPart<1>(name), voltage(voltage), branch_id(0), current(0) {}
+VoltageSource::VoltageSource(PartName name, scalar voltage) : NPinPart<1>(name), voltage(voltage), branch_id(0) {}
 
 VoltageSource::~VoltageSource() {}
 
-std::vector<MatrixEntry> VoltageSource::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node = pin().node;
-	if (node->is_ground) return {};
+void VoltageSource::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	if (node0->is_ground) return;
 
-	return { {node->node_id, branch_id, 1.0}, {branch_id, node->node_id, 1.0} };
+	entries.push_back({ node0->node_id, branch_id, 1.0 });
+	entries.push_back({ branch_id, node0->node_id, 1.0 });
 }
 
 scalar VoltageSource::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return current;
+	return current.get();
 }
 
-void VoltageSource::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
-	rhs[branch_id] += voltage;
+void VoltageSource::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	// the ground and other grounded sources have no row, branch_id is the row of the next part then
+	if (num_needed_matrix_rows() == 0) return;
+
+	rhs[branch_id] += params.source_scale * voltage;
 }
 
-void VoltageSource::update_value_from_result([[maybe_unused]] size_t i, scalar value) {
-	current = value;
+bool VoltageSource::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Voltage) return false;
+
+	voltage = value;
+	return true;
 }
 
 
 
-VoltageSource2Pin::VoltageSource2Pin(const std::string &name, scalar voltage) : NPinPart<2>(name), voltage(voltage), branch_id(0), current(0) {}
+VoltageSource2Pin::VoltageSource2Pin(PartName name, scalar voltage) : NPinPart<2>(name), voltage(voltage), branch_id(0) {}
 
 VoltageSource2Pin::~VoltageSource2Pin() {}
 
-std::vector<MatrixEntry> VoltageSource2Pin::gen_matrix_entries([[maybe_unused]] const StampParams &params) {
-	const auto &node0 = pin(0).node;
-	const auto &node1 = pin(1).node;
-
-	std::vector<MatrixEntry> entries;
+void VoltageSource2Pin::stamp_matrix_entries(std::vector<MatrixEntry> &entries, [[maybe_unused]] const StampParams &params) {
+	const auto &node0 = node(0);
+	const auto &node1 = node(1);
 
 	if (!node0->is_ground) {
 		entries.push_back({ node0->node_id, branch_id, 1.0 });
@@ -46,18 +51,19 @@ std::vector<MatrixEntry> VoltageSource2Pin::gen_matrix_entries([[maybe_unused]]
 		entries.push_back({ node1->node_id, branch_id, -1.0 });
 		entries.push_back({ branch_id, node1->node_id, -1.0 });
 	}
-
-	return entries;
 }
 
-void VoltageSource2Pin::stamp_rhs_entries(std::vector<scalar> &rhs, [[maybe_unused]] const StampParams &params) {
-	rhs[branch_id] += voltage;
+void VoltageSource2Pin::stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) {
+	rhs[branch_id] += params.source_scale * voltage;
 }
 
 scalar VoltageSource2Pin::get_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b) const {
-	return current;
+	return current.get();
 }
 
-void VoltageSource2Pin::update_value_from_result([[maybe_unused]] size_t i, scalar value) {
-	current = value;
+bool VoltageSource2Pin::set_parameter(Quantity quantity, scalar value) {
+	if (quantity != Quantity::Voltage) return false;
+
+	voltage = value;
+	return true;
 }
\ No newline at end of file
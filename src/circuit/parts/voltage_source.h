@@ -1,56 +1,73 @@
 #pragma once
 
 #include "circuit/n_pin_part.h"
+#include "circuit/name_table.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
 #include "circuit/scalar.h"
+#include "circuit/solution.h"
 
-#include <string>
+#include <span>
 
 
-class VoltageSource : public NPinPart<1> {
+class VoltageSource : public NPinPart<1>, public DrivablePart {
 private:
 	scalar voltage;
 	size_t branch_id;
 
-	scalar current;
+	SolutionEntry current;
 
 public:
-	explicit VoltageSource(const std::string &name, scalar voltage);
+	explicit VoltageSource(PartName name, scalar voltage);
 	~VoltageSource() noexcept;
 
-	size_t num_needed_matrix_rows() const override { return pin().node->is_ground ? 0 : 1; }
+	size_t num_needed_matrix_rows() const override { return node(0)->is_ground ? 0 : 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
 
-	void update_value_from_result(size_t i, scalar value) override;
+	// the current is the row of the source in the solution, a grounded source has none and reads 0
+	void bind_solution(std::span<const scalar> solution) override {
+		if (num_needed_matrix_rows() > 0) current.bind(solution, branch_id);
+		else current.unbind();
+	}
+
+	void drive(scalar value) override { voltage = value; }
+
+	bool set_parameter(Quantity quantity, scalar value) override;
 };
 
 
-class VoltageSource2Pin : public NPinPart<2> {
+class VoltageSource2Pin : public NPinPart<2>, public DrivablePart {
 private:
 	scalar voltage;
 	size_t branch_id;
 
-	scalar current;
+	SolutionEntry current;
 
 public:
-	explicit VoltageSource2Pin(const std::string &name, scalar voltage);
+	explicit VoltageSource2Pin(PartName name, scalar voltage);
 	~VoltageSource2Pin() noexcept;
 
 	size_t num_needed_matrix_rows() const override { return 1; }
 	void set_first_matrix_row_id(size_t row_id) override { branch_id = row_id; }
 	size_t get_first_matrix_row_id() override { return branch_id; }
 
-	std::vector<MatrixEntry> gen_matrix_entries(const StampParams &params) override;
-	void stamp_rhs_entries(std::vector<scalar> &rhs, const StampParams &params) override;
+	void stamp_matrix_entries(std::vector<MatrixEntry> &entries, const StampParams &params) override;
+	void stamp_rhs_entries(std::span<scalar> rhs, const StampParams &params) override;
 
 	scalar get_current_between(const ConstPin &a, const ConstPin &b) const override;
+	complex_scalar get_ac_current_between([[maybe_unused]] const ConstPin &a, [[maybe_unused]] const ConstPin &b, std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const override { return solution[branch_id]; }
+
+	// the current is the row of the source in the solution
+	void bind_solution(std::span<const scalar> solution) override { current.bind(solution, branch_id); }
+
+	void drive(scalar value) override { voltage = value; }
 
-	void update_value_from_result(size_t i, scalar value) override;
+	bool set_parameter(Quantity quantity, scalar value) override;
 };
\ No newline at end of file
@@ -2,26 +2,37 @@
 
 #include "circuit/node.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 
 
 class Part;
 
+// The pins are passed around by value, they are just the part, the node and the index of the pin.
+// The name is formatted from the part when it is needed, see part.h.
 struct Pin {
-	size_t pin_id;
+	uint32_t pin_id;
 	Node *node;
 	Part *owner;
-	std::string name;
 
-	constexpr Pin(size_t pin_id, Node *node, Part *owner, const std::string &name) : pin_id(pin_id), node(node), owner(owner), name(name) {}
+	constexpr Pin(size_t pin_id, Node *node, Part *owner) : pin_id(static_cast<uint32_t>(pin_id)), node(node), owner(owner) {}
+
+	// <part name>.<pin name>
+	std::string name() const;
 };
 
 struct ConstPin {
-	size_t pin_id;
+	uint32_t pin_id;
 	const Node *node;
 	const Part *owner;
-	std::string name;
 
-	constexpr ConstPin(size_t pin_id, const Node *node, const Part *owner, const std::string &name) : pin_id(pin_id), node(node), owner(owner), name(name) {}
-	constexpr ConstPin(const Pin &pin) : pin_id(pin.pin_id), node(pin.node), owner(pin.owner), name(pin.name) {}
+	constexpr ConstPin(size_t pin_id, const Node *node, const Part *owner) : pin_id(static_cast<uint32_t>(pin_id)), node(node), owner(owner) {}
+	constexpr ConstPin(const Pin &pin) : pin_id(pin.pin_id), node(pin.node), owner(pin.owner) {}
+
+	// <part name>.<pin name>
+	std::string name() const;
 };
+
+static_assert(std::is_trivially_copyable_v<Pin> && std::is_trivially_copyable_v<ConstPin>);
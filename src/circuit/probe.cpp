@@ -0,0 +1,19 @@
+#include "circuit/probe.h"
+
+#include "circuit/part.h"
+#include "circuit/pin.h"
+#include "circuit/scalar.h"
+
+
+Probe::Probe(Type type, const ConstPin &a, const ConstPin &b) : type(type), a(a), b(b) {}
+
+scalar Probe::measure() const {
+	if (type == Type::Voltage) {
+		return a.node->voltage() - b.node->voltage();
+	}
+	return a.owner->get_current_between(a, b);
+}
+
+std::string_view Probe::get_values_name() const noexcept {
+	return type == Type::Voltage ? "voltage" : "current";
+}
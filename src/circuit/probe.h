@@ -0,0 +1,36 @@
+#pragma once
+
+#include "circuit/pin.h"
+#include "circuit/scalar.h"
+
+#include <string>
+
+
+// Measures a voltage between two pins or a current between two pins of the same part.
+// Unlike scopes it does not store anything, it just reads the current value.
+// For current probes pin a and b must be of the same part or the single pin voltage source and ground pin.
+class Probe {
+public:
+	enum class Type {
+		Voltage,
+		Current
+	};
+
+private:
+	Type type;
+
+	ConstPin a;
+	ConstPin b;
+
+public:
+	Probe(Type type, const ConstPin &a, const ConstPin &b);
+
+	scalar measure() const;
+
+	Type get_type() const noexcept { return type; }
+	const ConstPin &pin_a() const noexcept { return a; }
+	const ConstPin &pin_b() const noexcept { return b; }
+
+	// "voltage" or "current"
+	std::string_view get_values_name() const noexcept;
+};
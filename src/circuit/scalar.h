@@ -1,5 +1,6 @@
 #pragma once
 
+#include <complex>
 
 #ifdef HIGH_PRECISION
 using scalar = double;
@@ -7,6 +8,9 @@ using scalar = double;
 using scalar = float;
 #endif // HIGH_PRECISION
 
+// the phasors of the ac analysis
+using complex_scalar = std::complex<scalar>;
+
 
 constexpr scalar operator""_s(long double v) {
 	return static_cast<scalar>(v);
@@ -1,59 +1,575 @@
 #include "circuit/scope.h"
 
+#include "circuit/checkpoint.h"
 #include "circuit/part.h"
 #include "circuit/pin.h"
+#include "circuit/probe.h"
 #include "circuit/scalar.h"
+#include "circuit/scope_writer.h"
+#include "circuit/time_axis.h"
+#include "circuit/util.h"
+#include "dsp/downsample.h"
+#include "dsp/welch.h"
+#include "io/csv_writer.h"
+#include "io/plot_data.h"
+#include "io/table_file.h"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
 #include <filesystem>
 #include <format>
-#include <fstream>
 #include <iostream>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 
 Scope::Scope(const ConstPin &a, const ConstPin &b, const fs::path &export_path, const std::string &values_name) :
 	export_path(export_path),
+	bucket_count(0),
+	bucket_min(0.0),
+	bucket_max(0.0),
+	bucket_sum(0.0),
+	history_next(0),
+	history_count(0),
+	trigger_sample(0),
+	capture_left(0),
+	holdoff_left(0),
+	trigger_done(false),
+	writer(nullptr),
+	table_id(0),
+	chunk_size(0),
+	submitted_rows(0),
+	streamed(false),
 	a(a), b(b),
 	values_name(values_name) {
-	name = std::format("{}-between-{}-and-{}", values_name, a.name, b.name);
+	name = std::format("{}-between-{}-and-{}", values_name, a.name(), b.name());
 }
 
-void Scope::export_table() const {
-	fs::path filename = std::format("{}.csv", name);
-	fs::path filepath = export_path / filename;
-	std::ofstream file(filepath);
-	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open output file: " + filepath.string());
+void Scope::set_decimation(const Decimation &decimation) {
+	if (decimation.factor == 0) {
+		throw std::invalid_argument(std::format("The decimation factor of the scope {} has to be at least 1.", name));
 	}
+	if (is_triggered() && decimation.mode != Decimation::Mode::None) {
+		throw std::invalid_argument(std::format("The triggered scope {} cannot be decimated.", name));
+	}
+	if (is_spectrum() && decimation.mode != Decimation::Mode::None) {
+		throw std::invalid_argument(std::format("The spectrum scope {} cannot be decimated.", name));
+	}
+
+	this->decimation = decimation;
+	clear();
+}
+
+void Scope::set_trigger(const Trigger &trigger) {
+	if (trigger.mode != Trigger::Mode::None && decimation.mode != Decimation::Mode::None) {
+		throw std::invalid_argument(std::format("The decimated scope {} cannot be triggered.", name));
+	}
+	if (trigger.mode != Trigger::Mode::None && is_spectrum()) {
+		throw std::invalid_argument(std::format("The spectrum scope {} cannot be triggered.", name));
+	}
+
+	this->trigger = trigger;
+	history.assign(trigger.mode == Trigger::Mode::None ? 0 : trigger.pre, 0.0);
+	clear();
+}
+
+void Scope::set_spectrum(size_t frame_size) {
+	if (frame_size != 0) {
+		if (frame_size < 4 || !std::has_single_bit(frame_size)) {
+			throw std::invalid_argument(std::format("The frame size of the spectrum of {} has to be a power of two of at least 4, got {}.", name, frame_size));
+		}
+		if (decimation.mode != Decimation::Mode::None) {
+			throw std::invalid_argument(std::format("The decimated scope {} cannot record a spectrum.", name));
+		}
+		if (is_triggered()) {
+			throw std::invalid_argument(std::format("The triggered scope {} cannot record a spectrum.", name));
+		}
+	}
+
+	spectrum = frame_size == 0 ? nullptr : std::make_unique<WelchSpectrum>(frame_size);
+	clear();
+}
+
+void Scope::reserve(size_t samples) {
+	// the spectrum does not grow with the run at all
+	if (is_spectrum()) return;
+
+	// the windows do not grow with the run
+	if (is_triggered()) {
+		values.reserve(values.size() + trigger.pre + 1 + trigger.post);
+		return;
+	}
+
+	const size_t kept = decimation.mode == Decimation::Mode::None ? samples : samples / decimation.factor + 1;
+	// a streamed scope never holds more than a chunk
+	size_t needed = values.size() + kept;
+	if (writer) needed = std::min(needed, chunk_size);
+	if (needed <= values.capacity()) return;
+
+	// grown at least geometrically, the blocks reserve a few samples at a time
+	size_t capacity = std::max(needed, 2 * values.capacity());
+	if (writer) capacity = std::min(capacity, chunk_size);
+	values.reserve(capacity);
+	if (decimation.mode == Decimation::Mode::Envelope) {
+		mins.reserve(capacity);
+		maxs.reserve(capacity);
+	}
+}
+
+void Scope::record_value(scalar value) {
+	if (spectrum) {
+		spectrum->push(value);
+		return;
+	}
+	if (is_triggered()) {
+		record_triggered(value);
+		return;
+	}
+
+	switch (decimation.mode) {
+		case Decimation::Mode::None:
+			values.push_back(value);
+			break;
+
+		case Decimation::Mode::Every:
+			if (bucket_count == 0) values.push_back(value);
+			if (++bucket_count == decimation.factor) bucket_count = 0;
+			break;
+
+		case Decimation::Mode::Envelope:
+			if (bucket_count == 0) {
+				bucket_min = value;
+				bucket_max = value;
+				bucket_sum = value;
+			}
+			else {
+				bucket_min = std::min(bucket_min, value);
+				bucket_max = std::max(bucket_max, value);
+				bucket_sum += value;
+			}
+
+			if (++bucket_count == decimation.factor) {
+				values.push_back(bucket_sum / static_cast<scalar>(bucket_count));
+				mins.push_back(bucket_min);
+				maxs.push_back(bucket_max);
+				bucket_count = 0;
+			}
+			break;
+	}
+
+	if (writer && values.size() >= chunk_size) submit_chunk();
+}
+
+bool Scope::triggers(scalar source) const noexcept {
+	switch (trigger.mode) {
+		case Trigger::Mode::Rising:
+			return previous_source && *previous_source < trigger.level && source >= trigger.level;
+		case Trigger::Mode::Falling:
+			return previous_source && *previous_source > trigger.level && source <= trigger.level;
+		case Trigger::Mode::Above:
+			return source > trigger.level;
+		case Trigger::Mode::Below:
+			return source < trigger.level;
+		default:
+			return false;
+	}
+}
+
+void Scope::record_triggered(scalar value) {
+	const scalar source = trigger.source ? trigger.source->measure() : value;
+
+	if (capture_left > 0) {
+		values.push_back(value);
+		++windows.back().rows;
+		if (--capture_left == 0) holdoff_left = trigger.holdoff;
+	}
+	else if (!trigger_done && holdoff_left == 0 && triggers(source)) {
+		// the pre-trigger samples from the oldest one, the buffer is full unless the run has just started
+		windows.push_back({ .first_sample = static_cast<std::ptrdiff_t>(trigger_sample) - static_cast<std::ptrdiff_t>(history_count), .rows = history_count + 1 });
+		const size_t oldest = history.empty() ? 0 : (history_next + history.size() - history_count) % history.size();
+		for (size_t i = 0; i < history_count; ++i) {
+			values.push_back(history[(oldest + i) % history.size()]);
+		}
+		values.push_back(value);
+
+		history_count = 0;
+		capture_left = trigger.post;
+		if (capture_left == 0) holdoff_left = trigger.holdoff;
+		trigger_done = trigger.single;
+	}
+	else {
+		if (holdoff_left > 0) --holdoff_left;
+
+		if (!history.empty()) {
+			history[history_next] = value;
+			history_next = (history_next + 1) % history.size();
+			history_count = std::min(history_count + 1, history.size());
+		}
+	}
+
+	previous_source = source;
+	++trigger_sample;
+}
+
+void Scope::record_ac(scalar frequency, complex_scalar phasor) {
+	frequencies.push_back(frequency);
+	phasors.push_back(phasor);
+}
+
+void Scope::clear() {
+	values.clear();
+	mins.clear();
+	maxs.clear();
+	bucket_count = 0;
+	history_next = 0;
+	history_count = 0;
+	trigger_sample = 0;
+	previous_source.reset();
+	capture_left = 0;
+	holdoff_left = 0;
+	trigger_done = false;
+	windows.clear();
+	if (spectrum) spectrum->clear();
+	submitted_rows = 0;
+	streamed = false;
+	frequencies.clear();
+	phasors.clear();
+}
+
+void Scope::save_checkpoint(CheckpointWriter &out) const {
+	out.write_size(spectrum ? spectrum->get_frame_size() : 0);
+	if (spectrum) spectrum->save_checkpoint(out);
+
+	out.write_bool(is_triggered());
+	if (!is_triggered()) return;
+
+	out.write_scalars(history);
+	out.write_size(history_next);
+	out.write_size(history_count);
+	out.write_bool(previous_source.has_value());
+	out.write_scalar(previous_source.value_or(scalar{ 0 }));
+	out.write_size(capture_left);
+	out.write_size(holdoff_left);
+	out.write_bool(trigger_done);
+}
+
+void Scope::load_checkpoint(CheckpointReader &in) {
+	const auto mismatch = [this]() {
+		return std::runtime_error(std::format("The checkpoint was saved with another recording of the scope {}.", name));
+	};
+
+	if (in.read_size() != (spectrum ? spectrum->get_frame_size() : 0)) throw mismatch();
+	if (spectrum) spectrum->load_checkpoint(in);
+
+	if (in.read_bool() != is_triggered()) throw mismatch();
+	if (!is_triggered()) return;
+
+	std::vector<scalar> saved_history = in.read_scalars();
+	if (saved_history.size() != history.size()) throw mismatch();
+	history = std::move(saved_history);
+	const size_t next = in.read_size();
+	history_next = history.empty() ? 0 : next % history.size();
+	history_count = std::min(in.read_size(), history.size());
+
+	const bool has_previous = in.read_bool();
+	const scalar previous_value = in.read_scalar();
+	previous_source = has_previous ? std::optional<scalar>(previous_value) : std::nullopt;
+	capture_left = in.read_size();
+	holdoff_left = in.read_size();
+	trigger_done = in.read_bool();
+
+	// the rest of the window that was being captured, from the first sample of the resumed run
+	if (capture_left > 0) windows.push_back({ .first_sample = static_cast<std::ptrdiff_t>(trigger_sample), .rows = 0 });
+}
+
+void Scope::stream_to(ScopeWriter &writer, size_t table, size_t chunk_size) {
+	if (chunk_size == 0) throw std::invalid_argument("The chunk size of a streamed scope has to be at least 1.");
+
+	this->writer = &writer;
+	table_id = table;
+	this->chunk_size = chunk_size;
+	streamed = true;
+}
 
-	file << "time," << values_name << "\n";
+void Scope::submit_chunk() {
+	ScopeChunk *chunk = writer->take_chunk();
+	chunk->table = table_id;
+	chunk->first_row = submitted_rows;
+	submitted_rows += values.size();
+	chunk->values.swap(values);
+	chunk->mins.swap(mins);
+	chunk->maxs.swap(maxs);
 
-	for (size_t i = 0; i < times.size(); ++i) {
-		file << times[i] << "," << values[i] << "\n";
+	writer->submit(chunk);
+
+	// a new chunk has no memory yet
+	values.reserve(chunk_size);
+	if (decimation.mode == Decimation::Mode::Envelope) {
+		mins.reserve(chunk_size);
+		maxs.reserve(chunk_size);
 	}
+}
 
-	file.close();
+void Scope::end_stream() {
+	if (!writer) return;
 
-	fs::remove(export_path.parent_path() / "latest" / filename);
-	fs::copy_file(filepath, export_path.parent_path() / "latest" / filename);
+	if (decimation.mode == Decimation::Mode::Envelope && bucket_count > 0) {
+		values.push_back(bucket_sum / static_cast<scalar>(bucket_count));
+		mins.push_back(bucket_min);
+		maxs.push_back(bucket_max);
+		bucket_count = 0;
+	}
 
-	std::cout << "Exported " << values_name << " table " << filepath << std::endl;
+	try {
+		if (!values.empty()) submit_chunk();
+	}
+	catch (...) {
+		writer = nullptr;
+		throw;
+	}
+	writer = nullptr;
+}
+
+std::string Scope::table_filename() const {
+	return std::format("{}.csv", name);
 }
 
-void Scope::plot(sciplot::Plot2D &p) const {
+std::string Scope::table_header() const {
+	if (is_triggered()) return std::format("time,{},window", values_name);
+	if (decimation.mode == Decimation::Mode::Envelope) {
+		return std::format("time,{0}_min,{0}_max,{0}_mean", values_name);
+	}
+	return std::format("time,{}", values_name);
+}
+
+std::vector<fs::path> Scope::export_table(const TimeAxis &axis, bool time_table) const {
+	std::vector<fs::path> exported;
+
+	auto finish_table = [&](const fs::path &filename) {
+		link_into(export_path / filename, export_path.parent_path() / "latest");
+		exported.push_back(export_path / filename);
+	};
+
+	// a run with just the ac analysis has no time table
+	if (!time_table) {}
+	else if (is_spectrum()) {
+		if (spectrum->frame_count() > 0 || frequencies.empty()) {
+			fs::path filename = std::format("spectrum-{}.csv", name);
+			CsvWriter file(export_path / filename);
+
+			file.text(std::format("frequency,{0}_psd,{0}_psd_db", values_name));
+			file.end_row();
+
+			const double samplerate = 1.0 / static_cast<double>(axis.timestep);
+			const std::vector<double> density = spectrum->density(samplerate);
+			for (size_t k = 0; k < density.size(); ++k) {
+				file.number(static_cast<scalar>(static_cast<double>(k) * samplerate / static_cast<double>(spectrum->get_frame_size())));
+				file.comma();
+				file.number(static_cast<scalar>(density[k]));
+				file.comma();
+				file.number(static_cast<scalar>(10.0 * std::log10(density[k])));
+				file.end_row();
+			}
+
+			file.close();
+			finish_table(filename);
+		}
+	}
+	else if (streamed) {
+		finish_table(table_filename());
+	}
+	else if (!values.empty() || bucket_count > 0 || frequencies.empty()) {
+		fs::path filename = table_filename();
+		CsvWriter file(export_path / filename);
+
+		file.text(table_header());
+		file.end_row();
+
+		if (is_triggered()) {
+			size_t row = 0;
+			for (size_t w = 0; w < windows.size(); ++w) {
+				for (size_t i = 0; i < windows[w].rows; ++i, ++row) {
+					file.number(axis.time(windows[w].first_sample + static_cast<std::ptrdiff_t>(i)));
+					file.comma();
+					file.number(values[row]);
+					file.comma();
+					file.text(std::to_string(w));
+					file.end_row();
+				}
+			}
+		}
+		else if (decimation.mode == Decimation::Mode::Envelope) {
+			auto row = [&](scalar time, scalar min, scalar max, scalar mean) {
+				file.number(time);
+				file.comma();
+				file.number(min);
+				file.comma();
+				file.number(max);
+				file.comma();
+				file.number(mean);
+				file.end_row();
+			};
+
+			for (size_t i = 0; i < values.size(); ++i) {
+				row(axis.time(i * stride()), mins[i], maxs[i], values[i]);
+			}
+			// the last bucket is not full yet
+			if (bucket_count > 0) {
+				row(axis.time(values.size() * stride()), bucket_min, bucket_max, bucket_sum / static_cast<scalar>(bucket_count));
+			}
+		}
+		else {
+			for (size_t i = 0; i < values.size(); ++i) {
+				file.number(axis.time(i * stride()));
+				file.comma();
+				file.number(values[i]);
+				file.end_row();
+			}
+		}
+
+		file.close();
+		finish_table(filename);
+	}
+
+	if (!frequencies.empty()) {
+		fs::path filename = std::format("ac-{}.csv", name);
+		CsvWriter file(export_path / filename);
+
+		file.text("frequency,magnitude,phase");
+		file.end_row();
+
+		for (size_t i = 0; i < frequencies.size(); ++i) {
+			file.number(frequencies[i]);
+			file.comma();
+			file.number(std::abs(phasors[i]));
+			file.comma();
+			file.number(std::arg(phasors[i]) * 180.0 / std::numbers::pi_v<scalar>);
+			file.end_row();
+		}
+
+		file.close();
+		finish_table(filename);
+	}
+
+	return exported;
+}
+
+void Scope::table_columns(std::vector<TableColumn> &columns) const {
+	if (!on_time_axis()) return;
+
+	if (decimation.mode == Decimation::Mode::Envelope) {
+		// the last bucket is not full yet
+		const bool pending = bucket_count > 0;
+		const scalar mean = pending ? bucket_sum / static_cast<scalar>(bucket_count) : 0.0;
+
+		columns.push_back({ name, values_name + "_min", stride(), mins, pending ? std::optional(bucket_min) : std::nullopt });
+		columns.push_back({ name, values_name + "_max", stride(), maxs, pending ? std::optional(bucket_max) : std::nullopt });
+		columns.push_back({ name, values_name + "_mean", stride(), values, pending ? std::optional(mean) : std::nullopt });
+	}
+	else {
+		columns.push_back({ name, values_name, stride(), values, std::nullopt });
+	}
+}
+
+void Scope::plot(sciplot::Plot2D &p, const TimeAxis &axis, PlotData &data, size_t width) const {
 	using namespace sciplot;
 
 	p.palette("paired");
 
-	if constexpr (std::is_same_v<scalar, double>) {
-		p.drawCurve(times, values);
+	if (is_spectrum()) {
+		const double samplerate = 1.0 / static_cast<double>(axis.timestep);
+		const std::vector<double> density = spectrum->density(samplerate);
+
+		std::vector<double> db(density.size());
+		for (size_t k = 0; k < density.size(); ++k) {
+			db[k] = 10.0 * std::log10(density[k]);
+		}
+
+		const std::vector<size_t> kept = lttb_indices(std::span<const double>(db), width);
+		std::vector<double> x(kept.size());
+		std::vector<double> y(kept.size());
+		for (size_t i = 0; i < kept.size(); ++i) {
+			x[i] = static_cast<double>(kept[i]) * samplerate / static_cast<double>(spectrum->get_frame_size());
+			y[i] = db[kept[i]];
+		}
+		data.draw(p, "lines", { x, y });
+
+		p.xlabel("frequency");
+		p.ylabel(std::format("{} density in dB ({})", values_name, name));
+		p.legend().hide();
+
+		std::cout << "Plotted " << name << std::endl;
+		return;
 	}
-	else {
-		std::vector<double> x(times.begin(), times.end());
-		std::vector<double> y(values.begin(), values.end());
 
-		p.drawCurve(x, y);
+	if (is_triggered()) {
+		// every window is a curve of its own
+		size_t row = 0;
+		for (const auto &window : windows) {
+			const std::vector<size_t> kept = lttb_indices(std::span<const scalar>(values.data() + row, window.rows), width);
+			std::vector<double> x(kept.size());
+			std::vector<double> y(kept.size());
+			for (size_t i = 0; i < kept.size(); ++i) {
+				x[i] = axis.time(window.first_sample + static_cast<std::ptrdiff_t>(kept[i]));
+				y[i] = values[row + kept[i]];
+			}
+			data.draw(p, "lines", { x, y });
+			row += window.rows;
+		}
+	}
+	else if (decimation.mode == Decimation::Mode::Envelope) {
+		// the last bucket is not full yet
+		const size_t rows = values.size() + (bucket_count > 0 ? 1 : 0);
+		auto row_min = [&](size_t i) { return i < values.size() ? mins[i] : bucket_min; };
+		auto row_max = [&](size_t i) { return i < values.size() ? maxs[i] : bucket_max; };
+		auto row_mean = [&](size_t i) { return i < values.size() ? values[i] : bucket_sum / static_cast<scalar>(bucket_count); };
+
+		// the buckets of every pixel are merged into one
+		const size_t pixels = width == 0 ? rows : std::min(width, rows);
+		std::vector<double> x(pixels);
+		std::vector<double> low(pixels);
+		std::vector<double> high(pixels);
+		std::vector<double> mean(pixels);
+		for (size_t b = 0; b < pixels; ++b) {
+			const size_t first = b * rows / pixels;
+			const size_t last = (b + 1) * rows / pixels;
+
+			x[b] = axis.time(first * stride());
+			low[b] = row_min(first);
+			high[b] = row_max(first);
+			double sum = 0.0;
+			for (size_t i = first; i < last; ++i) {
+				low[b] = std::min(low[b], static_cast<double>(row_min(i)));
+				high[b] = std::max(high[b], static_cast<double>(row_max(i)));
+				sum += row_mean(i);
+			}
+			mean[b] = sum / static_cast<double>(last - first);
+		}
+
+		// the band between the min and the max with the mean in it
+		data.draw(p, "filledcurves", { x, low, high }).fillIntensity(0.4);
+		data.draw(p, "lines", { x, mean });
+	}
+	else {
+		// two points per pixel, so that no peak gets lost
+		const std::vector<size_t> kept = min_max_indices(std::span<const scalar>(values), width);
+		std::vector<double> x(kept.size());
+		std::vector<double> y(kept.size());
+		for (size_t i = 0; i < kept.size(); ++i) {
+			x[i] = axis.time(kept[i] * stride());
+			y[i] = values[kept[i]];
+		}
+		data.draw(p, "lines", { x, y });
 	}
 
 	p.xlabel("time");
@@ -69,10 +585,12 @@ VoltageScope::VoltageScope(const ConstPin &a, const ConstPin &b, const fs::path
 	Scope(a, b, export_path, "voltage") {
 }
 
-void VoltageScope::record(scalar time) {
-	scalar voltage = a.node->voltage - b.node->voltage;
-	times.push_back(time);
-	values.push_back(voltage);
+scalar VoltageScope::measure() const {
+	return a.node->voltage() - b.node->voltage();
+}
+
+complex_scalar VoltageScope::measure_ac(std::span<const complex_scalar> solution, [[maybe_unused]] scalar omega) const {
+	return ac_voltage(a.node, solution) - ac_voltage(b.node, solution);
 }
 
 CurrentScope::CurrentScope(const ConstPin &a, const ConstPin &b, const fs::path &export_path) :
@@ -80,9 +598,12 @@ CurrentScope::CurrentScope(const ConstPin &a, const ConstPin &b, const fs::path
 	assert(a.owner == b.owner);
 }
 
-void CurrentScope::record(scalar time) {
+scalar CurrentScope::measure() const {
+	const Part *part = a.owner;
+	return part->get_current_between(a, b);
+}
+
+complex_scalar CurrentScope::measure_ac(std::span<const complex_scalar> solution, scalar omega) const {
 	const Part *part = a.owner;
-	scalar current = part->get_current_between(a, b);
-	times.push_back(time);
-	values.push_back(current);
+	return part->get_ac_current_between(a, b, solution, omega);
 }
@@ -1,11 +1,22 @@
 #pragma once
 
+#include "circuit/checkpoint.h"
 #include "circuit/pin.h"
+#include "circuit/probe.h"
 #include "circuit/scalar.h"
+#include "circuit/scope_writer.h"
+#include "circuit/time_axis.h"
+#include "dsp/welch.h"
+#include "io/plot_data.h"
+#include "io/table_file.h"
 
+#include <cstddef>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <span>
 #include <sciplot/sciplot.hpp>
+#include <string>
 #include <vector>
 
 
@@ -13,12 +24,104 @@ namespace fs = std::filesystem;
 
 
 class Scope {
+public:
+	// What a scope keeps of the samples, long runs keep only a fraction of them:
+	// every factor-th sample, or the min, max and mean of every bucket of factor samples.
+	struct Decimation {
+		enum class Mode {
+			None,
+			Every,
+			Envelope,
+		};
+
+		Mode mode = Mode::None;
+		size_t factor = 1;
+	};
+
+	// Records only windows around events instead of the whole run: a ring buffer keeps the last pre samples
+	// and when the source fulfils the condition, the scope commits them with the sample and the post samples after it.
+	// A rising or falling edge is a crossing of the level, above and below fire on every sample past it.
+	// After a window the trigger waits holdoff samples before it arms again, a single trigger records one window.
+	struct Trigger {
+		enum class Mode {
+			None,
+			Rising,
+			Falling,
+			Above,
+			Below,
+		};
+
+		Mode mode = Mode::None;
+		scalar level = 0.0;
+		size_t pre = 100;
+		size_t post = 900;
+		size_t holdoff = 0;
+		bool single = false;
+		// the scoped quantity when empty
+		std::optional<Probe> source;
+	};
+
+	// the recorded samples of a triggered scope, its rows are grouped into windows of consecutive samples,
+	// the first one is before the time axis when the window began before the run was resumed
+	struct Window {
+		std::ptrdiff_t first_sample;
+		size_t rows;
+	};
+
 private:
 	fs::path export_path;
 
+	Decimation decimation;
+
+	// the bucket being filled, the number of samples is counted for every mode
+	size_t bucket_count;
+	scalar bucket_min;
+	scalar bucket_max;
+	scalar bucket_sum;
+
+	Trigger trigger;
+
+	// the samples before the next trigger, history_next is where the next one goes
+	std::vector<scalar> history;
+	size_t history_next;
+	size_t history_count;
+	// the number of the sample being recorded and the source of the trigger at the previous one
+	size_t trigger_sample;
+	std::optional<scalar> previous_source;
+	// the samples the current window still needs, then the samples until the trigger arms again
+	size_t capture_left;
+	size_t holdoff_left;
+	bool trigger_done;
+	std::vector<Window> windows;
+
+	bool triggers(scalar source) const noexcept;
+	void record_triggered(scalar value);
+
+	// the averaged spectrum of a spectrum scope, which keeps no samples
+	std::unique_ptr<WelchSpectrum> spectrum;
+
+	// the writer of the streamed table, nullptr when the scope keeps its recording in memory
+	ScopeWriter *writer;
+	size_t table_id;
+	size_t chunk_size;
+	// the rows handed to the writer, the first row of the next chunk
+	size_t submitted_rows;
+	// the time table has been written by a writer
+	bool streamed;
+
+	// hands the recorded rows to the writer and continues in the memory of a written chunk
+	void submit_chunk();
+
 protected:
-	std::vector<scalar> times;
+	// the times are on the time axis of the circuit, values are the means of the envelope
 	std::vector<scalar> values;
+	// the envelope only
+	std::vector<scalar> mins;
+	std::vector<scalar> maxs;
+
+	// the ac analysis
+	std::vector<scalar> frequencies;
+	std::vector<complex_scalar> phasors;
 
 	ConstPin a;
 	ConstPin b;
@@ -30,12 +133,80 @@ public:
 	Scope(const ConstPin &a, const ConstPin &b, const fs::path &export_path, const std::string &values_name);
 	virtual ~Scope() = default;
 
-	// TODO: add reserve method to reserve memory before the run
-
-	virtual void record(scalar time) = 0;
-
-	void export_table() const;
-	void plot(sciplot::Plot2D &p) const;
+	// Throws std::invalid_argument for a factor of 0, a triggered or a spectrum scope. Drops the recorded values, like clear().
+	void set_decimation(const Decimation &decimation);
+	inline const Decimation &get_decimation() const noexcept { return decimation; }
+
+	// Throws std::invalid_argument when the scope is decimated or a spectrum scope, the pre-trigger buffer is allocated here.
+	// Drops the recorded values, like clear().
+	void set_trigger(const Trigger &trigger);
+	inline const Trigger &get_trigger() const noexcept { return trigger; }
+	inline bool is_triggered() const noexcept { return trigger.mode != Trigger::Mode::None; }
+
+	// Keeps just the Welch-averaged power spectral density of the samples, from Hann windowed frames of frame_size samples
+	// overlapping by a half, in the memory of a few frames. A frame size of 0 records the samples again. Throws std::invalid_argument
+	// when the frame size is not a power of two of at least 4 or the scope is decimated or triggered. Drops the recorded values, like clear().
+	void set_spectrum(size_t frame_size);
+	inline bool is_spectrum() const noexcept { return spectrum != nullptr; }
+
+	// the rows of the time table are on the grid of the time axis, they can be streamed and joined
+	inline bool on_time_axis() const noexcept { return !is_triggered() && !is_spectrum(); }
+
+	// reserves the memory for the next samples, a triggered scope for its next window, so that recording them does not allocate
+	void reserve(size_t samples);
+
+	// the current value of the scoped quantity
+	virtual scalar measure() const = 0;
+
+	// the phasor of the scoped quantity in the solution of the ac analysis at the angular frequency omega
+	virtual complex_scalar measure_ac(std::span<const complex_scalar> solution, scalar omega) const = 0;
+
+	// records the next sample of the time axis
+	inline void record() { record_value(measure()); }
+	// records a value measured elsewhere, the adaptive stepping records interpolated values
+	void record_value(scalar value);
+	void record_ac(scalar frequency, complex_scalar phasor);
+
+	// drops the recorded values, keeps the memory
+	void clear();
+
+	// The state that carries over to a resumed run: the trigger with its pre-trigger samples and the window it is capturing,
+	// which goes on as a window from the resumed start, and the averaged spectrum. The recorded rows are not saved,
+	// the tables of a resumed run start at its start, and neither is an unfinished bucket, which the tables of the run
+	// before already end with. Loading throws std::runtime_error when the scope was saved with another trigger or spectrum.
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+
+	// From now on the recorded rows go to table of the writer in chunks of chunk_size rows,
+	// only the last chunk is kept in memory. The writer has to outlive the stream.
+	void stream_to(ScopeWriter &writer, size_t table, size_t chunk_size);
+	// submits the rest of the recording, including an unfinished bucket of the envelope
+	void end_stream();
+
+	// <name>.csv and its first line
+	std::string table_filename() const;
+	std::string table_header() const;
+
+	// the samples of the time axis per row
+	inline size_t stride() const noexcept { return decimation.mode == Decimation::Mode::None ? 1 : decimation.factor; }
+
+	inline void set_export_path(const fs::path &path) { export_path = path; }
+	inline const std::string &get_name() const noexcept { return name; }
+	inline const std::string &get_values_name() const noexcept { return values_name; }
+
+	// Writes <name>.csv with the recorded values (the time, min, max and mean of the envelope, the window of a triggered scope) and ac-<name>.csv with the magnitude and phase
+	// (in degrees) of the ac analysis, each one only when it has something recorded, and links them into latest/. A streamed <name>.csv
+	// is only linked. Without time_table just the ac table is written, the binary export writes the time table. Returns the written tables.
+	// The times are taken from the axis the scope has recorded on. A spectrum scope writes spectrum-<name>.csv instead of <name>.csv,
+	// with the density (also in dB) over the frequency.
+	std::vector<fs::path> export_table(const TimeAxis &axis, bool time_table = true) const;
+
+	// appends the columns of the time table for the binary and joined exports, they point into the recording,
+	// a scope that is not on the time axis has none
+	void table_columns(std::vector<TableColumn> &columns) const;
+	// Draws the recording with about width points (0 draws all of them) through the binary files of data:
+	// the min and max of every pixel, the merged buckets of an envelope and LTTB for the windows and the spectrum.
+	void plot(sciplot::Plot2D &p, const TimeAxis &axis, PlotData &data, size_t width) const;
 };
 
 
@@ -43,12 +214,14 @@ class VoltageScope : public Scope {
 public:
 	VoltageScope(const ConstPin &a, const ConstPin &b, const fs::path &export_path);
 
-	void record(scalar time) override;
+	scalar measure() const override;
+	complex_scalar measure_ac(std::span<const complex_scalar> solution, scalar omega) const override;
 };
 
 class CurrentScope : public Scope {
 public:
 	CurrentScope(const ConstPin &a, const ConstPin &b, const fs::path &export_path);
 
-	void record(scalar time) override;
+	scalar measure() const override;
+	complex_scalar measure_ac(std::span<const complex_scalar> solution, scalar omega) const override;
 };
\ No newline at end of file
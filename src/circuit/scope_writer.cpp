@@ -0,0 +1,129 @@
+#include "circuit/scope_writer.h"
+
+#include "circuit/scalar.h"
+#include "circuit/time_axis.h"
+#include "io/csv_writer.h"
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+ScopeWriter::ScopeWriter(const std::vector<fs::path> &table_paths, const std::vector<std::string> &headers, const std::vector<size_t> &table_strides, const TimeAxis &axis) :
+	paths(table_paths),
+	strides(table_strides),
+	axis(axis),
+	filled(queue_chunks),
+	spare(2 * queue_chunks),
+	failed(false),
+	error(nullptr) {
+
+	files.reserve(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i) {
+		CsvWriter &file = files.emplace_back(paths[i], table_buffer_size);
+		file.text(headers[i]);
+		file.end_row();
+	}
+
+	thread = std::jthread([this](std::stop_token stop) { write_loop(stop); });
+}
+
+ScopeWriter::~ScopeWriter() noexcept {
+	if (thread.joinable()) {
+		thread.request_stop();
+		thread.join();
+	}
+}
+
+void ScopeWriter::write_chunk(ScopeChunk &chunk) {
+	CsvWriter &file = files[chunk.table];
+	const size_t stride = strides[chunk.table];
+
+	for (size_t i = 0; i < chunk.values.size(); ++i) {
+		file.number(axis.time((chunk.first_row + i) * stride));
+		file.comma();
+		if (!chunk.mins.empty()) {
+			file.number(chunk.mins[i]);
+			file.comma();
+			file.number(chunk.maxs[i]);
+			file.comma();
+		}
+		file.number(chunk.values[i]);
+		file.end_row();
+	}
+
+	if (!file.good()) throw std::runtime_error("Failed to write output file: " + paths[chunk.table].string());
+}
+
+void ScopeWriter::write_loop(std::stop_token stop) {
+	ScopeChunk *chunk = nullptr;
+
+	while (true) {
+		// read the flag first, so that no chunk submitted before the stop is missed
+		const bool stopping = stop.stop_requested();
+
+		if (!filled.try_pop(chunk)) {
+			if (stopping) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		// after an error the chunks are only drained, so the simulation does not wait for them
+		if (!failed.load(std::memory_order_acquire)) {
+			try {
+				write_chunk(*chunk);
+			}
+			catch (...) {
+				error = std::current_exception();
+				failed.store(true, std::memory_order_release);
+			}
+		}
+
+		chunk->values.clear();
+		chunk->mins.clear();
+		chunk->maxs.clear();
+		spare.try_push(chunk);
+	}
+}
+
+ScopeChunk *ScopeWriter::take_chunk() {
+	ScopeChunk *chunk = nullptr;
+	if (spare.try_pop(chunk)) return chunk;
+
+	return chunks.emplace_back(std::make_unique<ScopeChunk>()).get();
+}
+
+void ScopeWriter::submit(ScopeChunk *chunk) {
+	while (!filled.try_push(chunk)) {
+		if (failed.load(std::memory_order_acquire)) std::rethrow_exception(error);
+		std::this_thread::yield();
+	}
+}
+
+void ScopeWriter::close() {
+	if (thread.joinable()) {
+		thread.request_stop();
+		thread.join();
+	}
+
+	for (auto &file : files) {
+		try {
+			file.close();
+		}
+		catch (...) {
+			if (!failed) {
+				error = std::current_exception();
+				failed = true;
+			}
+		}
+	}
+	files.clear();
+
+	if (failed) std::rethrow_exception(error);
+}
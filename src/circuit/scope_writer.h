@@ -0,0 +1,81 @@
+#pragma once
+
+#include "circuit/scalar.h"
+#include "circuit/time_axis.h"
+#include "io/csv_writer.h"
+#include "stream/spsc_ring_buffer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// rows of one scope table on their way to the disk, mins and maxs are empty unless the scope records an envelope
+struct ScopeChunk {
+	size_t table = 0;
+	// the rows are numbered from the start of the table, the writer takes their times from the axis
+	size_t first_row = 0;
+	std::vector<scalar> values;
+	std::vector<scalar> mins;
+	std::vector<scalar> maxs;
+};
+
+// Writes the scope tables on a background thread while the circuit runs. The scopes hand over their rows
+// in chunks through a lock-free queue and get the memory of a written chunk back, so the memory of a run
+// stays the same however long it is. The simulation waits only when the disk falls behind a whole queue.
+// All methods except the ones of the writer thread itself are called from the simulation thread.
+class ScopeWriter {
+private:
+	// chunks in flight, the spare queue can take all of them back
+	static constexpr size_t queue_chunks = 16;
+	// every table has its own buffer
+	static constexpr size_t table_buffer_size = size_t{ 1 } << 16;
+
+	std::vector<CsvWriter> files;
+	std::vector<fs::path> paths;
+	// the samples of the axis per row of every table
+	std::vector<size_t> strides;
+	TimeAxis axis;
+
+	// owns every chunk, the queues pass pointers to them
+	std::vector<std::unique_ptr<ScopeChunk>> chunks;
+	SpscRingBuffer<ScopeChunk *> filled;
+	SpscRingBuffer<ScopeChunk *> spare;
+
+	std::atomic<bool> failed;
+	std::exception_ptr error;
+
+	std::jthread thread;
+
+	void write_chunk(ScopeChunk &chunk);
+	void write_loop(std::stop_token stop);
+
+public:
+	// Opens (and truncates) the tables and writes their headers, throws std::runtime_error when one cannot be opened.
+	// The rows of the tables are on the axis, which has to have its start already.
+	ScopeWriter(const std::vector<fs::path> &table_paths, const std::vector<std::string> &headers, const std::vector<size_t> &table_strides, const TimeAxis &axis);
+	// stops the thread, the rows not written yet are lost unless close() was called
+	~ScopeWriter() noexcept;
+
+	ScopeWriter(const ScopeWriter &) = delete;
+	ScopeWriter &operator=(const ScopeWriter &) = delete;
+
+	// an empty chunk, reused from the written ones whenever there is one
+	ScopeChunk *take_chunk();
+	// queues the chunk to be written, waits while the queue is full and rethrows the error of the writer thread
+	void submit(ScopeChunk *chunk);
+
+	// writes everything submitted, closes the tables and rethrows the error of the writer thread
+	void close();
+
+	inline const fs::path &table_path(size_t table) const noexcept { return paths[table]; }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "circuit/scalar.h"
+
+#include <cstddef>
+#include <span>
+
+
+// An entry of the solution of the circuit, which is its state: the node voltages followed by the rows
+// of the parts, e.g. the current through a voltage source. The circuit solves every step into the same array,
+// the nodes and parts read their values there by index instead of getting a copy after every solve.
+// An unbound entry (the ground, a circuit not prepared yet) reads 0.
+class SolutionEntry {
+private:
+	static constexpr scalar unsolved = 0.0;
+
+	const scalar *entry = &unsolved;
+
+public:
+	// the solution has to stay where it is while the entry is bound, the circuit binds again when it allocates a new one
+	inline void bind(std::span<const scalar> solution, size_t index) noexcept { entry = &solution[index]; }
+	inline void unbind() noexcept { entry = &unsolved; }
+
+	inline scalar get() const noexcept { return *entry; }
+};
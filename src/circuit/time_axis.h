@@ -0,0 +1,18 @@
+#pragma once
+
+#include "circuit/scalar.h"
+
+#include <cstddef>
+
+
+// The times of the samples recorded by the scopes of a circuit. All scopes record every sample at the same
+// time, so the circuit keeps the time base once and the scopes keep only their values: the sample i was
+// recorded at start + i * timestep, the row j of a scope decimated by a factor at the sample j * factor.
+// The pre-trigger samples of a window can be from before the start of a resumed run, their numbers are negative.
+struct TimeAxis {
+	scalar start = 0.0;
+	scalar timestep = 0.0;
+	size_t samples = 0;
+
+	inline scalar time(std::ptrdiff_t sample) const noexcept { return start + static_cast<scalar>(sample) * timestep; }
+};
@@ -2,8 +2,10 @@
 
 #include <chrono>
 #include <ctime>
+#include <filesystem>
 #include <format>
 #include <string>
+#include <system_error>
 
 
 std::string make_timestamp() {
@@ -30,6 +32,15 @@ std::string make_timestamp() {
 	);
 }
 
+void link_into(const fs::path &file, const fs::path &directory) {
+	const fs::path target = directory / file.filename();
+	fs::remove(target);
+
+	std::error_code error;
+	fs::create_hard_link(file, target, error);
+	if (error) fs::copy_file(file, target);
+}
+
 size_t floor_sqrt(size_t n) {
 	size_t lo = 0, hi = n, ans = 0;
 
@@ -2,12 +2,20 @@
 
 #include "circuit/scalar.h"
 
+#include <filesystem>
 #include <numbers>
 #include <string>
 
 
+namespace fs = std::filesystem;
+
+
 std::string make_timestamp();
 
+// Hard links the file into the directory under the same name, replacing the file there.
+// Copies it when the file system cannot link it, e.g. across file systems.
+void link_into(const fs::path &file, const fs::path &directory);
+
 size_t floor_sqrt(size_t n);
 size_t ceil_sqrt(size_t n);
 
@@ -0,0 +1,121 @@
+#include "dsp/decimator.h"
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+
+// the modified bessel function of the first kind and order 0, for the kaiser window
+static scalar bessel_i0(scalar x) {
+	scalar sum = 1.0;
+	scalar term = 1.0;
+	for (size_t k = 1; k < 64; ++k) {
+		term *= (x / (2.0 * static_cast<scalar>(k))) * (x / (2.0 * static_cast<scalar>(k)));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+// The independent partial sums keep the additions in order per lane,
+// so the compiler can vectorize the loop without reassociating the floating point sum.
+static scalar dot(const scalar *a, const scalar *b, size_t n) noexcept {
+	constexpr size_t lanes = 8;
+	std::array<scalar, lanes> acc{};
+
+	size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		for (size_t l = 0; l < lanes; ++l) {
+			acc[l] += a[i + l] * b[i + l];
+		}
+	}
+	for (; i < n; ++i) {
+		acc[0] += a[i] * b[i];
+	}
+
+	scalar sum = 0.0;
+	for (scalar x : acc) sum += x;
+	return sum;
+}
+
+
+Decimator::Decimator(size_t factor, size_t taps_per_phase) :
+	factor(factor),
+	num_taps(factor * taps_per_phase),
+	pos(0),
+	phase(0) {
+	if (factor == 0 || taps_per_phase == 0) {
+		throw std::invalid_argument("The decimation factor and the taps per phase must be positive.");
+	}
+
+	constexpr scalar beta = 8.0;
+	// the -6 dB point in cycles per input sample, the transition band of the window ends at the output Nyquist
+	const scalar cutoff = 0.42 / static_cast<scalar>(factor);
+	const scalar center = static_cast<scalar>(num_taps - 1) / 2.0;
+
+	taps.resize(num_taps);
+	scalar sum = 0.0;
+	for (size_t i = 0; i < num_taps; ++i) {
+		const scalar x = static_cast<scalar>(i) - center;
+		const scalar sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * std::numbers::pi_v<scalar> * cutoff * x) / (std::numbers::pi_v<scalar> * x);
+		const scalar r = x / center;
+		const scalar window = center > 0.0 ? bessel_i0(beta * std::sqrt(std::max<scalar>(0.0, 1.0 - r * r))) / bessel_i0(beta) : 1.0;
+
+		taps[i] = sinc * window;
+		sum += taps[i];
+	}
+
+	// unity gain at dc
+	for (auto &tap : taps) tap /= sum;
+
+	history.assign(2 * num_taps, 0.0);
+}
+
+bool Decimator::push(scalar x, scalar &out) noexcept {
+	pos = (pos == 0 ? num_taps : pos) - 1;
+	history[pos] = x;
+	history[pos + num_taps] = x;
+
+	if (++phase < factor) return false;
+
+	phase = 0;
+	out = dot(taps.data(), history.data() + pos, num_taps);
+	return true;
+}
+
+void Decimator::process(std::span<const scalar> in, std::span<scalar> out) {
+	if (in.size() != out.size() * factor) {
+		throw std::invalid_argument("Decimator::process expects factor times more input than output samples.");
+	}
+
+	size_t j = 0;
+	for (scalar x : in) {
+		if (push(x, out[j])) ++j;
+	}
+}
+
+void Decimator::reset(scalar value) noexcept {
+	std::fill(history.begin(), history.end(), value);
+	pos = 0;
+	phase = 0;
+}
+
+void Decimator::save_checkpoint(CheckpointWriter &out) const {
+	out.write_scalars(history);
+	out.write_size(pos);
+	out.write_size(phase);
+}
+
+void Decimator::load_checkpoint(CheckpointReader &in) {
+	in.read_scalars(history);
+	pos = in.read_size() % num_taps;
+	phase = in.read_size() % factor;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+// Lowpass FIR decimator by an integer factor, used to bring oversampled signals down to the output rate.
+// It evaluates the filter only for the kept outputs (the polyphase form), so the cost is taps_per_phase
+// multiply-adds per input sample. The filter is a Kaiser windowed sinc with the passband up to about
+// 0.34 and the stopband from 0.5 of the output rate, so nothing above the output Nyquist frequency aliases.
+class Decimator {
+private:
+	size_t factor;
+	size_t num_taps;
+
+	std::vector<scalar> taps;
+
+	// the history is stored twice in a row, so the last num_taps samples are always contiguous
+	// starting at pos, newest first, and the filter is one straight dot product
+	std::vector<scalar> history;
+	size_t pos;
+	size_t phase;
+
+public:
+	static constexpr size_t default_taps_per_phase = 32;
+
+	explicit Decimator(size_t factor, size_t taps_per_phase = default_taps_per_phase);
+
+	// pushes one input sample, every factor-th sample completes an output sample, then returns true
+	bool push(scalar x, scalar &out) noexcept;
+
+	// decimates a block, in.size() has to be out.size() * factor
+	void process(std::span<const scalar> in, std::span<scalar> out);
+
+	// fills the history with value, as if the input had been constant before, the next input sample starts a new output sample
+	void reset(scalar value = 0.0) noexcept;
+
+	// the history and the position in it, the taps follow from the factor
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+
+	inline size_t get_factor() const noexcept { return factor; }
+
+	// the group delay of the filter in output samples
+	inline scalar delay() const noexcept { return static_cast<scalar>(num_taps - 1) / 2.0 / static_cast<scalar>(factor); }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+// Picks the points of a long curve that are worth drawing, the graphs need about one point per pixel.
+// The samples are evenly spaced, so the indices stand in for the x coordinates.
+
+// The minimum and the maximum of every one of the buckets in the order they were sampled,
+// so the peaks stay, however narrow they are. Short curves are kept whole.
+template <class T>
+std::vector<size_t> min_max_indices(std::span<const T> y, size_t buckets) {
+	std::vector<size_t> indices;
+	if (buckets == 0 || y.size() <= 2 * buckets) {
+		indices.resize(y.size());
+		for (size_t i = 0; i < y.size(); ++i) indices[i] = i;
+		return indices;
+	}
+
+	indices.reserve(2 * buckets);
+	for (size_t b = 0; b < buckets; ++b) {
+		const size_t first = b * y.size() / buckets;
+		const size_t last = (b + 1) * y.size() / buckets;
+
+		const auto [min, max] = std::minmax_element(y.begin() + first, y.begin() + last);
+		const size_t low = static_cast<size_t>(min - y.begin());
+		const size_t high = static_cast<size_t>(max - y.begin());
+
+		indices.push_back(std::min(low, high));
+		if (low != high) indices.push_back(std::max(low, high));
+	}
+	return indices;
+}
+
+// Largest-Triangle-Three-Buckets: the first and the last point and from every bucket between them the point that spans
+// the largest triangle with the point kept before it and the mean of the next bucket, which keeps the shape of smooth
+// curves with the given number of points. Short curves are kept whole.
+template <class T>
+std::vector<size_t> lttb_indices(std::span<const T> y, size_t points) {
+	std::vector<size_t> indices;
+	if (points < 3 || y.size() <= points) {
+		indices.resize(y.size());
+		for (size_t i = 0; i < y.size(); ++i) indices[i] = i;
+		return indices;
+	}
+
+	indices.reserve(points);
+	indices.push_back(0);
+
+	// the buckets divide the points between the first and the last one
+	const size_t n = y.size() - 2;
+	const size_t buckets = points - 2;
+	auto bucket_start = [&](size_t b) { return 1 + b * n / buckets; };
+
+	size_t kept = 0;
+	for (size_t b = 0; b < buckets; ++b) {
+		const size_t first = bucket_start(b);
+		const size_t last = bucket_start(b + 1);
+
+		// the mean of the next bucket, the last point after the last bucket
+		double next_x = static_cast<double>(y.size() - 1);
+		double next_y = static_cast<double>(y.back());
+		if (b + 1 < buckets) {
+			const size_t next_last = bucket_start(b + 2);
+			next_x = 0.0;
+			next_y = 0.0;
+			for (size_t i = last; i < next_last; ++i) {
+				next_x += static_cast<double>(i);
+				next_y += static_cast<double>(y[i]);
+			}
+			next_x /= static_cast<double>(next_last - last);
+			next_y /= static_cast<double>(next_last - last);
+		}
+
+		const double kept_x = static_cast<double>(kept);
+		const double kept_y = static_cast<double>(y[kept]);
+
+		// twice the area, the factor does not change the largest one
+		size_t best = first;
+		double best_area = -1.0;
+		for (size_t i = first; i < last; ++i) {
+			const double area = std::abs((kept_x - next_x) * (static_cast<double>(y[i]) - kept_y) - (kept_x - static_cast<double>(i)) * (next_y - kept_y));
+			if (area > best_area) {
+				best_area = area;
+				best = i;
+			}
+		}
+
+		indices.push_back(best);
+		kept = best;
+	}
+
+	indices.push_back(y.size() - 1);
+	return indices;
+}
@@ -0,0 +1,85 @@
+#include "dsp/fft.h"
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+Fft::Fft(size_t size) :
+	n(size),
+	reversed(size),
+	twiddle_re(size),
+	twiddle_im(size) {
+	if (!std::has_single_bit(size)) throw std::invalid_argument("The size of an FFT has to be a power of two.");
+
+	const int bits = std::countr_zero(size);
+	for (size_t i = 1; i < n; ++i) {
+		reversed[i] = (reversed[i >> 1] >> 1) | ((i & 1) << (bits - 1));
+	}
+
+	for (size_t m = 1; m < n; m *= 2) {
+		for (size_t j = 0; j < m; ++j) {
+			const double angle = -std::numbers::pi * static_cast<double>(j) / static_cast<double>(m);
+			twiddle_re[m + j] = std::cos(angle);
+			twiddle_im[m + j] = std::sin(angle);
+		}
+	}
+}
+
+void Fft::transform(std::span<double> re, std::span<double> im) const noexcept {
+	for (size_t i = 0; i < n; ++i) {
+		const size_t j = reversed[i];
+		if (i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+
+	size_t m = 1;
+	if (n >= 4) {
+		// the passes of m = 1 and m = 2 at once, their twiddles are 1 and -i
+		for (size_t k = 0; k < n; k += 4) {
+			const double a0r = re[k] + re[k + 1], a0i = im[k] + im[k + 1];
+			const double a1r = re[k] - re[k + 1], a1i = im[k] - im[k + 1];
+			const double a2r = re[k + 2] + re[k + 3], a2i = im[k + 2] + im[k + 3];
+			const double a3r = re[k + 2] - re[k + 3], a3i = im[k + 2] - im[k + 3];
+
+			re[k] = a0r + a2r;
+			im[k] = a0i + a2i;
+			re[k + 2] = a0r - a2r;
+			im[k + 2] = a0i - a2i;
+			// -i * a3
+			re[k + 1] = a1r + a3i;
+			im[k + 1] = a1i - a3r;
+			re[k + 3] = a1r - a3i;
+			im[k + 3] = a1i + a3r;
+		}
+		m = 4;
+	}
+
+	for (; m < n; m *= 2) {
+		const double *wr = twiddle_re.data() + m;
+		const double *wi = twiddle_im.data() + m;
+
+		for (size_t k = 0; k < n; k += 2 * m) {
+			double *ar = re.data() + k;
+			double *ai = im.data() + k;
+			double *br = ar + m;
+			double *bi = ai + m;
+
+			for (size_t j = 0; j < m; ++j) {
+				const double tr = br[j] * wr[j] - bi[j] * wi[j];
+				const double ti = br[j] * wi[j] + bi[j] * wr[j];
+				br[j] = ar[j] - tr;
+				bi[j] = ai[j] - ti;
+				ar[j] += tr;
+				ai[j] += ti;
+			}
+		}
+	}
+}
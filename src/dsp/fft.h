@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+// An in-place complex FFT of a power of two size with precomputed twiddles. The data is split into the real
+// and the imaginary parts, so that every butterfly loop runs over contiguous arrays and the compiler vectorizes it.
+// The first two stages are one radix-4 pass without multiplications, the others are radix-2 passes.
+class Fft {
+private:
+	size_t n;
+	// the index every element is swapped with before the passes
+	std::vector<size_t> reversed;
+	// the twiddles of the pass of half size m are at [m, 2m), exp(-i pi j / m)
+	std::vector<double> twiddle_re;
+	std::vector<double> twiddle_im;
+
+public:
+	// throws std::invalid_argument unless the size is a power of two
+	explicit Fft(size_t size);
+
+	inline size_t size() const noexcept { return n; }
+
+	// the forward transform X_k = sum x_j exp(-2 pi i j k / n), re and im have to have the size of the transform
+	void transform(std::span<double> re, std::span<double> im) const noexcept;
+};
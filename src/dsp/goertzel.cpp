@@ -0,0 +1,33 @@
+#include "dsp/goertzel.h"
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <cmath>
+#include <numbers>
+
+
+Goertzel::Goertzel(scalar frequency) :
+	coeff(2.0 * std::cos(2.0 * std::numbers::pi * static_cast<double>(frequency))),
+	s1(0.0),
+	s2(0.0) {
+}
+
+double Goertzel::power() const noexcept {
+	return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+void Goertzel::reset() noexcept {
+	s1 = 0.0;
+	s2 = 0.0;
+}
+
+void Goertzel::save_checkpoint(CheckpointWriter &out) const {
+	out.write_double(s1);
+	out.write_double(s2);
+}
+
+void Goertzel::load_checkpoint(CheckpointReader &in) {
+	s1 = in.read_double();
+	s2 = in.read_double();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+
+// The power of a single frequency of a signal, updated a sample at a time: the Goertzel filter gives one bin
+// of the DFT for a multiply-add per sample, without storing the samples. The state is double, the runs are long.
+class Goertzel {
+private:
+	double coeff;
+	double s1;
+	double s2;
+
+public:
+	// the frequency in cycles per sample
+	explicit Goertzel(scalar frequency);
+
+	inline void push(scalar x) noexcept {
+		const double s0 = static_cast<double>(x) + coeff * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+
+	// |X|^2 of the bin over the samples pushed so far
+	double power() const noexcept;
+
+	void reset() noexcept;
+
+	// the state, the coefficient follows from the frequency
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+};
@@ -0,0 +1,190 @@
+#include "dsp/sample_file.h"
+
+#include "circuit/scalar.h"
+#include "io/mapped_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+// the files are little endian, so they are assembled byte by byte
+static uint32_t read_u16(const std::byte *p) noexcept {
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+}
+
+static uint32_t read_u32(const std::byte *p) noexcept {
+	return read_u16(p) | (read_u16(p + 2) << 16);
+}
+
+static bool has_tag(const std::byte *p, std::string_view tag) noexcept {
+	for (size_t i = 0; i < 4; ++i) {
+		if (static_cast<char>(p[i]) != tag[i]) return false;
+	}
+	return true;
+}
+
+
+SampleFile::SampleFile(const fs::path &path, scalar raw_rate) :
+	file(path, "sample file"),
+	data(nullptr),
+	num_frames(0),
+	num_channels(1),
+	bytes_per_sample(4),
+	encoding(Encoding::Float32),
+	rate(raw_rate) {
+
+	const std::byte *map = file.data();
+	if (file.size() >= 12 && has_tag(map, "RIFF") && has_tag(map + 8, "WAVE")) {
+		parse_wav(path);
+		// an explicit rate plays the recording faster or slower
+		if (raw_rate > 0.0) rate = raw_rate;
+	}
+	else {
+		if (raw_rate <= 0.0) {
+			throw std::invalid_argument("The sample rate of the raw sample file " + path.string() + " has to be given.");
+		}
+		data = map;
+		num_frames = file.size() / bytes_per_sample;
+	}
+}
+
+void SampleFile::parse_wav(const fs::path &path) {
+	const auto format_error = [&](const std::string &reason) {
+		return std::runtime_error("Invalid WAV file " + path.string() + ": " + reason);
+	};
+
+	const std::byte *map = file.data();
+	const size_t map_size = file.size();
+
+	bool has_format = false;
+	size_t pos = 12;
+
+	// the chunks are an id, a size and the content padded to an even size
+	while (pos + 8 <= map_size) {
+		const std::byte *chunk = map + pos;
+		const size_t size = read_u32(chunk + 4);
+		const size_t available = map_size - (pos + 8);
+
+		if (has_tag(chunk, "fmt ")) {
+			if (size < 16 || size > available) throw format_error("the format chunk is truncated.");
+
+			uint32_t format = read_u16(chunk + 8);
+			num_channels = read_u16(chunk + 10);
+			rate = static_cast<scalar>(read_u32(chunk + 12));
+			const uint32_t bits = read_u16(chunk + 22);
+
+			// the extensible format stores the format in the first two bytes of its subformat guid
+			if (format == 0xFFFE) {
+				if (size < 40) throw format_error("the extensible format chunk is truncated.");
+				format = read_u16(chunk + 32);
+			}
+
+			if (format == 1 && bits == 8) encoding = Encoding::UInt8;
+			else if (format == 1 && bits == 16) encoding = Encoding::Int16;
+			else if (format == 1 && bits == 24) encoding = Encoding::Int24;
+			else if (format == 1 && bits == 32) encoding = Encoding::Int32;
+			else if (format == 3 && bits == 32) encoding = Encoding::Float32;
+			else if (format == 3 && bits == 64) encoding = Encoding::Float64;
+			else throw format_error("only 8, 16, 24 and 32 bit integer and 32 and 64 bit float PCM are supported.");
+
+			if (num_channels == 0 || rate <= 0.0) throw format_error("it has no channels or no sample rate.");
+
+			bytes_per_sample = bits / 8;
+			has_format = true;
+		}
+		else if (has_tag(chunk, "data")) {
+			if (!has_format) throw format_error("the data chunk comes before the format chunk.");
+
+			// streamed files leave the size unset, the data then lasts until the end of the file
+			data = chunk + 8;
+			num_frames = std::min(size, available) / (bytes_per_sample * num_channels);
+			return;
+		}
+
+		pos += 8 + size + (size & 1);
+	}
+
+	throw format_error("it has no data chunk.");
+}
+
+scalar SampleFile::decode(const std::byte *sample) const noexcept {
+	switch (encoding) {
+		case Encoding::UInt8:
+			return (static_cast<scalar>(sample[0]) - 128.0) / 128.0;
+
+		case Encoding::Int16:
+			return static_cast<scalar>(static_cast<int16_t>(read_u16(sample))) / 32768.0;
+
+		case Encoding::Int24: {
+			// shifted up to the sign bit of 32 bits and back to sign extend it
+			const uint32_t bits = (read_u16(sample) | (static_cast<uint32_t>(sample[2]) << 16)) << 8;
+			return static_cast<scalar>(static_cast<int32_t>(bits) >> 8) / 8388608.0;
+		}
+
+		case Encoding::Int32:
+			return static_cast<scalar>(static_cast<int32_t>(read_u32(sample))) / 2147483648.0;
+
+		case Encoding::Float32:
+			return static_cast<scalar>(std::bit_cast<float>(read_u32(sample)));
+
+		case Encoding::Float64: {
+			const uint64_t bits = read_u32(sample) | (static_cast<uint64_t>(read_u32(sample + 4)) << 32);
+			return static_cast<scalar>(std::bit_cast<double>(bits));
+		}
+	}
+
+	return 0.0;
+}
+
+scalar SampleFile::frame(ptrdiff_t i) const noexcept {
+	if (i < 0 || static_cast<size_t>(i) >= num_frames) return 0.0;
+
+	const std::byte *first = data + static_cast<size_t>(i) * num_channels * bytes_per_sample;
+	if (num_channels == 1) return decode(first);
+
+	scalar sum = 0.0;
+	for (size_t c = 0; c < num_channels; ++c) {
+		sum += decode(first + c * bytes_per_sample);
+	}
+	return sum / static_cast<scalar>(num_channels);
+}
+
+scalar SampleFile::value(scalar t, scalar h) const noexcept {
+	const scalar x = t * rate;
+	const scalar width = h * rate;
+
+	// far enough outside that no sample reaches it, this also keeps the conversions below in range
+	const scalar end = static_cast<scalar>(num_frames) + 2.0;
+	if (!(x + width > -2.0 && x - width < end)) return 0.0;
+
+	if (width > 1.0) {
+		// the samples in the step centered at t, the ones outside of the recording are silence
+		const scalar last = std::floor(x + 0.5 * width);
+		const scalar first = std::floor(x - 0.5 * width) + 1.0;
+
+		const ptrdiff_t lo = static_cast<ptrdiff_t>(std::max<scalar>(first, 0.0));
+		const ptrdiff_t hi = static_cast<ptrdiff_t>(std::min<scalar>(last, end));
+
+		scalar sum = 0.0;
+		for (ptrdiff_t i = lo; i <= hi; ++i) sum += frame(i);
+		return sum / (last - first + 1.0);
+	}
+
+	const scalar floor_x = std::floor(x);
+	const ptrdiff_t i = static_cast<ptrdiff_t>(floor_x);
+	const scalar f = x - floor_x;
+
+	const scalar p0 = frame(i - 1);
+	const scalar p1 = frame(i);
+	const scalar p2 = frame(i + 1);
+	const scalar p3 = frame(i + 2);
+
+	return p1 + 0.5 * f * ((p2 - p0) + f * ((2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) + f * (3.0 * (p1 - p2) + p3 - p0)));
+}
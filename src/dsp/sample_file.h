@@ -0,0 +1,60 @@
+#pragma once
+
+#include "circuit/scalar.h"
+#include "io/mapped_file.h"
+
+#include <cstddef>
+#include <filesystem>
+
+
+namespace fs = std::filesystem;
+
+
+// A recorded signal read straight from a memory-mapped file, the samples are decoded when they are read
+// and the operating system pages the file in and out, so a long recording costs neither a copy nor the memory.
+// Reads WAV files (8, 16, 24 and 32 bit integer or 32 and 64 bit float PCM, also in the extensible format)
+// and raw files of 32 bit little endian floats, whose rate has to be given. The channels are averaged
+// and the integer formats are scaled to -1 .. 1.
+class SampleFile {
+public:
+	enum class Encoding {
+		UInt8,
+		Int16,
+		Int24,
+		Int32,
+		Float32,
+		Float64,
+	};
+
+private:
+	MappedFile file;
+
+	// the samples start at data, each frame holds the samples of all channels
+	const std::byte *data;
+	size_t num_frames;
+	size_t num_channels;
+	size_t bytes_per_sample;
+	Encoding encoding;
+	scalar rate;
+
+	void parse_wav(const fs::path &path);
+
+	scalar decode(const std::byte *sample) const noexcept;
+
+public:
+	// raw_rate is the sample rate of a raw file, a WAV file takes it from its header when raw_rate is 0
+	explicit SampleFile(const fs::path &path, scalar raw_rate = 0.0);
+
+	inline scalar sample_rate() const noexcept { return rate; }
+	inline size_t frames() const noexcept { return num_frames; }
+	inline size_t channels() const noexcept { return num_channels; }
+	inline scalar duration() const noexcept { return static_cast<scalar>(num_frames) / rate; }
+
+	// the frame i with the channels averaged, 0 outside of the recording
+	scalar frame(ptrdiff_t i) const noexcept;
+
+	// The signal at the time t, resampled to a step of length h. When the steps are shorter than the samples
+	// it is interpolated by a cubic through the 4 nearest samples (Catmull-Rom), when they are longer the samples
+	// within a step around t are averaged, which lowpasses them before they are sampled by the steps.
+	scalar value(scalar t, scalar h) const noexcept;
+};
@@ -0,0 +1,95 @@
+#include "dsp/sine_generator.h"
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+
+SineGenerator::SineGenerator(scalar angular_vel, scalar phase) noexcept :
+	angular_vel(angular_vel),
+	phase(phase),
+	block{},
+	cursor(block_size),
+	block_time(0.0),
+	next_time(std::numeric_limits<scalar>::quiet_NaN()),
+	step(0.0) {
+}
+
+void SineGenerator::set(scalar angular_vel, scalar phase) noexcept {
+	this->angular_vel = angular_vel;
+	this->phase = phase;
+	invalidate();
+}
+
+void SineGenerator::invalidate() noexcept {
+	cursor = block_size;
+	next_time = std::numeric_limits<scalar>::quiet_NaN();
+	step = 0.0;
+}
+
+void SineGenerator::generate(scalar t, scalar h) noexcept {
+	// lane l holds the samples l, l + lanes, l + 2 * lanes, ..., all lanes rotate by lanes steps at once
+	std::array<scalar, lanes> re;
+	std::array<scalar, lanes> im;
+	for (size_t l = 0; l < lanes; ++l) {
+		const scalar angle = angular_vel * (t + static_cast<scalar>(l) * h) + phase;
+		re[l] = std::cos(angle);
+		im[l] = std::sin(angle);
+	}
+
+	const scalar rotation = angular_vel * h * static_cast<scalar>(lanes);
+	const scalar c = std::cos(rotation);
+	const scalar s = std::sin(rotation);
+
+	for (size_t k = 0; k < block_size; k += lanes) {
+		for (size_t l = 0; l < lanes; ++l) {
+			block[k + l] = im[l];
+
+			const scalar next_re = re[l] * c - im[l] * s;
+			im[l] = re[l] * s + im[l] * c;
+			re[l] = next_re;
+		}
+	}
+
+	cursor = 0;
+	block_time = t;
+}
+
+scalar SineGenerator::value(scalar t, scalar h) noexcept {
+	// the time of a fixed step is accumulated, so it is allowed to drift from the block by rounding
+	const bool continues = h == step && std::abs(t - next_time) <= h * 1e-6;
+
+	next_time = t + h;
+	step = h;
+
+	if (!continues) {
+		cursor = block_size;
+		return std::sin(angular_vel * t + phase);
+	}
+
+	if (cursor == block_size) generate(t, h);
+	return block[cursor++];
+}
+
+void SineGenerator::save_checkpoint(CheckpointWriter &out) const {
+	out.write_size(cursor);
+	out.write_scalar(block_time);
+	out.write_scalar(next_time);
+	out.write_scalar(step);
+}
+
+void SineGenerator::load_checkpoint(CheckpointReader &in) {
+	const size_t saved_cursor = in.read_size();
+	const scalar saved_block_time = in.read_scalar();
+	next_time = in.read_scalar();
+	step = in.read_scalar();
+
+	if (saved_cursor < block_size) generate(saved_block_time, step);
+	cursor = std::min(saved_cursor, block_size);
+	block_time = saved_block_time;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+
+#include <array>
+#include <cstddef>
+
+
+// Evaluates sin(angular_vel * t + phase) for a source that is stepped through time. When the steps are uniform
+// the values are generated a block ahead by rotating phasors, a complex multiplication per sample instead of
+// a std::sin. Each block starts from an exact std::sin/std::cos, so the rounding of the rotation does not
+// accumulate past one block. The times that do not continue the block (adaptive steps, restarts) are evaluated directly.
+class SineGenerator {
+public:
+	static constexpr size_t block_size = 256;
+
+private:
+	// the block is generated by independent rotations of interleaved samples, so the compiler vectorizes them
+	static constexpr size_t lanes = 8;
+
+	scalar angular_vel;
+	scalar phase;
+
+	std::array<scalar, block_size> block;
+	size_t cursor;
+	// the time the block starts at, a checkpoint regenerates the block from it
+	scalar block_time;
+
+	// the time and the step the next call has to have to continue the block
+	scalar next_time;
+	scalar step;
+
+	void generate(scalar t, scalar h) noexcept;
+
+public:
+	SineGenerator(scalar angular_vel, scalar phase) noexcept;
+
+	// changes the sine, drops the block
+	void set(scalar angular_vel, scalar phase) noexcept;
+	void invalidate() noexcept;
+
+	// the value at the time t of a step of length h
+	scalar value(scalar t, scalar h) noexcept;
+
+	// the position in the block, so that a restored source continues with the same values
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+};
@@ -0,0 +1,101 @@
+#include "dsp/welch.h"
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+#include "dsp/fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+
+WelchSpectrum::WelchSpectrum(size_t frame_size) :
+	frame_size(frame_size),
+	hop(frame_size / 2),
+	fft(frame_size),
+	window(frame_size),
+	window_power(0.0),
+	history(frame_size, 0.0),
+	re(frame_size),
+	im(frame_size),
+	power_sum(frame_size / 2 + 1, 0.0) {
+	if (frame_size < 4) throw std::invalid_argument("The frame of a spectrum has to have at least 4 samples.");
+
+	// the periodic Hann window, its frames overlapping by a half add up to a constant
+	for (size_t i = 0; i < frame_size; ++i) {
+		window[i] = 0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(frame_size));
+		window_power += window[i] * window[i];
+	}
+
+	clear();
+}
+
+void WelchSpectrum::push(scalar x) {
+	history[history_next] = x;
+	history_next = (history_next + 1) % frame_size;
+	history_count = std::min(history_count + 1, frame_size);
+
+	if (history_count < frame_size) return;
+
+	if (since_frame == 0) add_frame();
+	since_frame = (since_frame + 1) % hop;
+}
+
+void WelchSpectrum::add_frame() {
+	// the oldest sample is the one to be overwritten next
+	for (size_t i = 0; i < frame_size; ++i) {
+		re[i] = history[(history_next + i) % frame_size] * window[i];
+		im[i] = 0.0;
+	}
+
+	fft.transform(re, im);
+
+	for (size_t k = 0; k < power_sum.size(); ++k) {
+		power_sum[k] += re[k] * re[k] + im[k] * im[k];
+	}
+	++frames;
+}
+
+void WelchSpectrum::clear() noexcept {
+	std::fill(history.begin(), history.end(), 0.0);
+	history_next = 0;
+	history_count = 0;
+	since_frame = 0;
+
+	std::fill(power_sum.begin(), power_sum.end(), 0.0);
+	frames = 0;
+}
+
+void WelchSpectrum::save_checkpoint(CheckpointWriter &out) const {
+	out.write_doubles(history);
+	out.write_size(history_next);
+	out.write_size(history_count);
+	out.write_size(since_frame);
+	out.write_doubles(power_sum);
+	out.write_size(frames);
+}
+
+void WelchSpectrum::load_checkpoint(CheckpointReader &in) {
+	in.read_doubles(history);
+	history_next = in.read_size() % frame_size;
+	history_count = std::min(in.read_size(), frame_size);
+	since_frame = in.read_size() % hop;
+	in.read_doubles(power_sum);
+	frames = in.read_size();
+}
+
+std::vector<double> WelchSpectrum::density(double samplerate) const {
+	if (frames == 0) return {};
+
+	std::vector<double> result(power_sum.size());
+	const double scale = 1.0 / (static_cast<double>(frames) * samplerate * window_power);
+	for (size_t k = 0; k < result.size(); ++k) {
+		// the negative frequencies are folded onto the positive ones, except for dc and the Nyquist frequency
+		const bool folded = k != 0 && k != result.size() - 1;
+		result[k] = power_sum[k] * scale * (folded ? 2.0 : 1.0);
+	}
+	return result;
+}
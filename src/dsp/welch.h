@@ -0,0 +1,57 @@
+#pragma once
+
+#include "circuit/checkpoint.h"
+#include "circuit/scalar.h"
+#include "dsp/fft.h"
+
+#include <cstddef>
+#include <vector>
+
+
+// Welch's estimate of the power spectral density, accumulated while the samples come: the last frame_size samples
+// are kept in a ring buffer and every frame_size / 2 samples the frame is windowed by a Hann window, transformed and
+// its power added to the sums. The memory is a few frames, however long the signal is.
+class WelchSpectrum {
+private:
+	size_t frame_size;
+	size_t hop;
+	Fft fft;
+
+	std::vector<double> window;
+	// the sum of the squared window, the power of the window the density is normalized by
+	double window_power;
+
+	std::vector<double> history;
+	size_t history_next;
+	size_t history_count;
+	// the samples since the last frame
+	size_t since_frame;
+
+	std::vector<double> re;
+	std::vector<double> im;
+
+	// the bins 0 to frame_size / 2
+	std::vector<double> power_sum;
+	size_t frames;
+
+	void add_frame();
+
+public:
+	// throws std::invalid_argument unless the frame size is a power of two of at least 4
+	explicit WelchSpectrum(size_t frame_size);
+
+	inline size_t get_frame_size() const noexcept { return frame_size; }
+	inline size_t frame_count() const noexcept { return frames; }
+	inline size_t bin_count() const noexcept { return power_sum.size(); }
+
+	void push(scalar x);
+	void clear() noexcept;
+
+	// the last frame, the position in it and the sums, the window follows from the frame size
+	void save_checkpoint(CheckpointWriter &out) const;
+	void load_checkpoint(CheckpointReader &in);
+
+	// the one-sided density in the squared unit of the samples per Hz, the bin k is at k * samplerate / frame_size,
+	// empty before the first whole frame
+	std::vector<double> density(double samplerate) const;
+};
@@ -0,0 +1,51 @@
+#include "io/csv_writer.h"
+
+#include "circuit/scalar.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+
+CsvWriter::CsvWriter(const fs::path &path, size_t buffer_size) :
+	path(path),
+	file(path, std::ios::binary),
+	buffer(std::max(buffer_size, 2 * max_number_length)),
+	used(0) {
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open output file: " + path.string());
+	}
+}
+
+void CsvWriter::flush() {
+	file.write(buffer.data(), static_cast<std::streamsize>(used));
+	used = 0;
+}
+
+void CsvWriter::text(std::string_view text) {
+	while (!text.empty()) {
+		if (used == buffer.size()) flush();
+
+		const size_t n = std::min(text.size(), buffer.size() - used);
+		std::copy_n(text.data(), n, buffer.data() + used);
+		used += n;
+		text.remove_prefix(n);
+	}
+}
+
+void CsvWriter::number(scalar value) {
+	if (buffer.size() - used < max_number_length) flush();
+
+	const auto [end, ec] = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value, std::chars_format::general, 6);
+	used = static_cast<size_t>(end - buffer.data());
+}
+
+void CsvWriter::close() {
+	flush();
+	file.close();
+	if (!file) throw std::runtime_error("Failed to write output file: " + path.string());
+}
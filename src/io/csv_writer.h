@@ -0,0 +1,46 @@
+#pragma once
+
+#include "circuit/scalar.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// Writes a csv file through a large buffer, the numbers are formatted by std::to_chars the same way
+// as std::ostream formats them by default (%g with 6 significant digits), without the locale and the stream state.
+class CsvWriter {
+private:
+	fs::path path;
+	std::ofstream file;
+
+	std::vector<char> buffer;
+	size_t used;
+
+	// the longest number, e.g. -1.23457e-308
+	static constexpr size_t max_number_length = 32;
+
+	void flush();
+
+public:
+	static constexpr size_t default_buffer_size = size_t{ 1 } << 20;
+
+	// throws std::runtime_error when the file cannot be opened
+	explicit CsvWriter(const fs::path &path, size_t buffer_size = default_buffer_size);
+
+	void text(std::string_view text);
+	void number(scalar value);
+	inline void comma() { text(","); }
+	inline void end_row() { text("\n"); }
+
+	// false once a write of the buffer has failed
+	inline bool good() const { return static_cast<bool>(file); }
+
+	// writes out the rest, which is lost without it, throws std::runtime_error when the file could not be written
+	void close();
+};
@@ -0,0 +1,74 @@
+#include "io/mapped_file.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile(const fs::path &path, std::string_view what) :
+	map(nullptr),
+	map_size(0) {
+	const auto open_error = [&]() { return std::runtime_error("Cannot open " + std::string(what) + ": " + path.string()); };
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw open_error();
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		throw open_error();
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	// the view keeps the file open
+	CloseHandle(file);
+	if (!mapping) throw open_error();
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) throw open_error();
+
+	map = static_cast<const std::byte *>(view);
+	map_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw open_error();
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		throw open_error();
+	}
+
+	void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file open
+	close(fd);
+	if (view == MAP_FAILED) throw open_error();
+
+	// the files are read forward, so the kernel can read ahead and drop the pages behind
+	madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+	map = static_cast<const std::byte *>(view);
+	map_size = static_cast<size_t>(st.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() noexcept {
+#ifdef _WIN32
+	UnmapViewOfFile(map);
+#else
+	munmap(const_cast<std::byte *>(map), map_size);
+#endif
+}
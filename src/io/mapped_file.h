@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+
+namespace fs = std::filesystem;
+
+
+// A whole file mapped read-only into the memory, the operating system pages it in as it is read.
+// The file is read ahead sequentially, which suits both the recordings and the tables.
+class MappedFile {
+private:
+	const std::byte *map;
+	size_t map_size;
+
+public:
+	// throws std::runtime_error "Cannot open <what>: <path>" when the file cannot be opened or is empty
+	MappedFile(const fs::path &path, std::string_view what = "file");
+	~MappedFile() noexcept;
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	inline const std::byte *data() const noexcept { return map; }
+	inline size_t size() const noexcept { return map_size; }
+	inline std::span<const std::byte> bytes() const noexcept { return { map, map_size }; }
+};
@@ -0,0 +1,59 @@
+#include "io/plot_data.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <initializer_list>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+
+PlotData::PlotData() :
+	files(0) {
+	std::random_device random;
+	std::error_code error;
+
+	// a directory of its own, so that simultaneous runs do not share the files
+	for (size_t attempt = 0; attempt < 16; ++attempt) {
+		directory = fs::temp_directory_path() / std::format("simlogue-plot-{:08x}", random());
+		if (fs::create_directory(directory, error)) return;
+	}
+	throw std::runtime_error("Failed to create a temporary directory for the graphs in " + fs::temp_directory_path().string());
+}
+
+PlotData::~PlotData() noexcept {
+	std::error_code error;
+	fs::remove_all(directory, error);
+}
+
+sciplot::DrawSpecs &PlotData::draw(sciplot::Plot2D &p, const std::string &with, std::initializer_list<std::span<const double>> columns) {
+	const fs::path path = directory / std::format("curve{}.bin", files++);
+	const size_t rows = columns.size() == 0 ? 0 : columns.begin()->size();
+
+	// the rows interleaved, gnuplot reads them in the native byte order
+	std::vector<double> data;
+	data.reserve(rows * columns.size());
+	for (size_t i = 0; i < rows; ++i) {
+		for (const auto &column : columns) data.push_back(column[i]);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(double)));
+	file.close();
+	if (!file) throw std::runtime_error("Failed to write output file: " + path.string());
+
+	std::string format;
+	std::string use;
+	for (size_t c = 1; c <= columns.size(); ++c) {
+		format += "%float64";
+		use += (c > 1 ? ":" : "") + std::to_string(c);
+	}
+
+	return p.draw(std::format("'{}' binary format='{}'", path.generic_string(), format), use, with).lineStyle(++curves[&p]);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <initializer_list>
+#include <sciplot/sciplot.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// The data of the curves of the graphs as binary files, which gnuplot reads as they are instead of parsing
+// the numbers of the text data sets of sciplot. The files live in a temporary directory until the object
+// is destroyed, so it has to outlive the showing of the canvas.
+class PlotData {
+private:
+	fs::path directory;
+	size_t files;
+	// the curves drawn on every plot, each one gets the next line style of the palette like the ones of sciplot
+	std::unordered_map<const sciplot::Plot2D *, int> curves;
+
+public:
+	// throws std::runtime_error when the temporary directory cannot be created
+	PlotData();
+	~PlotData() noexcept;
+
+	PlotData(const PlotData &) = delete;
+	PlotData &operator=(const PlotData &) = delete;
+
+	// Writes the columns of equal length as rows of float64 and draws them on the plot with the style, e.g. "lines"
+	// or "filledcurves", the first column is x. Throws std::runtime_error when the file cannot be written.
+	sciplot::DrawSpecs &draw(sciplot::Plot2D &p, const std::string &with, std::initializer_list<std::span<const double>> columns);
+};
@@ -0,0 +1,289 @@
+#include "io/table_file.h"
+
+#include "circuit/scalar.h"
+#include "io/csv_writer.h"
+#include "io/mapped_file.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+static constexpr std::string_view table_magic{ "SLTABLE\0", 8 };
+static constexpr uint32_t table_version = 1;
+
+
+static void append_u32(std::string &out, uint32_t value) {
+	for (size_t i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+static void append_u64(std::string &out, uint64_t value) {
+	for (size_t i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+static void append_name(std::string &out, std::string_view name) {
+	append_u32(out, static_cast<uint32_t>(name.size()));
+	out.append(name);
+}
+
+static size_t align8(size_t n) noexcept {
+	return (n + 7) & ~size_t{ 7 };
+}
+
+// the values as T in little endian, converted a block at a time
+template <class T>
+static void write_values(std::ofstream &out, std::span<const scalar> values) {
+	if constexpr (std::is_same_v<T, scalar> && std::endian::native == std::endian::little) {
+		out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+	}
+	else {
+		using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+
+		std::array<Bits, 4096> block;
+		for (size_t first = 0; first < values.size(); first += block.size()) {
+			const size_t n = std::min(block.size(), values.size() - first);
+			for (size_t i = 0; i < n; ++i) {
+				const Bits bits = std::bit_cast<Bits>(static_cast<T>(values[first + i]));
+				if constexpr (std::endian::native == std::endian::little) block[i] = bits;
+				else block[i] = std::byteswap(bits);
+			}
+			out.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(n * sizeof(Bits)));
+		}
+	}
+}
+
+void write_table_file(const fs::path &path, TableFormat format, scalar start_time, scalar timestep, std::span<const TableColumn> columns) {
+	if (format != TableFormat::Float32 && format != TableFormat::Float64) throw std::invalid_argument("A table file holds float32 or float64 columns.");
+
+	const size_t bytes_per_value = format == TableFormat::Float32 ? 4 : 8;
+
+	auto column_count = [](const TableColumn &column) { return column.values.size() + (column.pending ? 1 : 0); };
+
+	size_t header_size = table_magic.size() + 4 + 4 + 8 + 8;
+	for (const auto &column : columns) {
+		header_size += 4 + column.table.size() + 4 + column.name.size() + 4 + 4 + 8 + 8;
+	}
+
+	std::string header;
+	header.reserve(header_size);
+	header.append(table_magic);
+	append_u32(header, table_version);
+	append_u32(header, static_cast<uint32_t>(columns.size()));
+	append_u64(header, std::bit_cast<uint64_t>(static_cast<double>(start_time)));
+	append_u64(header, std::bit_cast<uint64_t>(static_cast<double>(timestep)));
+
+	size_t offset = align8(header_size);
+	for (const auto &column : columns) {
+		append_name(header, column.table);
+		append_name(header, column.name);
+		append_u32(header, static_cast<uint32_t>(bytes_per_value));
+		append_u32(header, static_cast<uint32_t>(column.stride));
+		append_u64(header, column_count(column));
+		append_u64(header, offset);
+
+		offset = align8(offset + column_count(column) * bytes_per_value);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open output file: " + path.string());
+	}
+
+	static constexpr std::array<char, 8> padding{};
+	auto pad = [&](size_t written) { file.write(padding.data(), static_cast<std::streamsize>(align8(written) - written)); };
+
+	file.write(header.data(), static_cast<std::streamsize>(header.size()));
+	pad(header.size());
+
+	for (const auto &column : columns) {
+		const std::span<const scalar> pending = column.pending ? std::span<const scalar>(&*column.pending, 1) : std::span<const scalar>();
+
+		if (format == TableFormat::Float32) {
+			write_values<float>(file, column.values);
+			write_values<float>(file, pending);
+		}
+		else {
+			write_values<double>(file, column.values);
+			write_values<double>(file, pending);
+		}
+		pad(column_count(column) * bytes_per_value);
+	}
+
+	file.close();
+	if (!file) throw std::runtime_error("Failed to write output file: " + path.string());
+}
+
+void write_joined_csv(const fs::path &path, scalar start_time, scalar timestep, std::span<const TableColumn> columns) {
+	auto column_count = [](const TableColumn &column) { return column.values.size() + (column.pending ? 1 : 0); };
+
+	const size_t rows = columns.empty() ? 0 : column_count(columns.front());
+	const size_t stride = columns.empty() ? 1 : columns.front().stride;
+	for (const auto &column : columns) {
+		if (column_count(column) != rows || column.stride != stride) {
+			throw std::runtime_error("The joined table needs the same decimation for all scopes, " + column.table + " has another one.");
+		}
+	}
+
+	CsvWriter file(path);
+
+	file.text("time");
+	for (const auto &column : columns) {
+		file.comma();
+		file.text(column.name);
+	}
+	file.end_row();
+
+	for (size_t i = 0; i < rows; ++i) {
+		file.number(start_time + static_cast<scalar>(i * stride) * timestep);
+		for (const auto &column : columns) {
+			file.comma();
+			file.number(i < column.values.size() ? column.values[i] : *column.pending);
+		}
+		file.end_row();
+	}
+
+	file.close();
+}
+
+
+static uint32_t read_u32(const std::byte *p) noexcept {
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; ++i) value |= static_cast<uint32_t>(p[i]) << (8 * i);
+	return value;
+}
+
+static uint64_t read_u64(const std::byte *p) noexcept {
+	return read_u32(p) | (static_cast<uint64_t>(read_u32(p + 4)) << 32);
+}
+
+TableFile::TableFile(const fs::path &path) :
+	file(path, "table file"),
+	start(0.0),
+	step(0.0) {
+	const auto format_error = [&](const std::string &reason) {
+		return std::runtime_error("Invalid table file " + path.string() + ": " + reason);
+	};
+
+	const std::byte *map = file.data();
+	const size_t size = file.size();
+	size_t pos = 0;
+
+	auto need = [&](size_t n) {
+		if (n > size - pos) throw format_error("it is truncated.");
+	};
+	auto read_name = [&]() {
+		need(4);
+		const size_t length = read_u32(map + pos);
+		pos += 4;
+		need(length);
+		std::string name(reinterpret_cast<const char *>(map + pos), length);
+		pos += length;
+		return name;
+	};
+
+	need(table_magic.size() + 4 + 4 + 8 + 8);
+	if (std::string_view(reinterpret_cast<const char *>(map), table_magic.size()) != table_magic) {
+		throw format_error("it is not a SimLogue table file.");
+	}
+	pos += table_magic.size();
+
+	const uint32_t version = read_u32(map + pos);
+	if (version != table_version) throw format_error("version " + std::to_string(version) + " is not supported.");
+
+	const size_t count = read_u32(map + pos + 4);
+	start = static_cast<scalar>(std::bit_cast<double>(read_u64(map + pos + 8)));
+	step = static_cast<scalar>(std::bit_cast<double>(read_u64(map + pos + 16)));
+	pos += 24;
+
+	for (size_t i = 0; i < count; ++i) {
+		Column column;
+		column.table = read_name();
+		column.name = read_name();
+
+		need(4 + 4 + 8 + 8);
+		column.bytes_per_value = read_u32(map + pos);
+		column.stride = read_u32(map + pos + 4);
+		column.count = read_u64(map + pos + 8);
+		const uint64_t offset = read_u64(map + pos + 16);
+		pos += 24;
+
+		if (column.bytes_per_value != 4 && column.bytes_per_value != 8) throw format_error("a column is neither float32 nor float64.");
+		if (column.stride == 0) throw format_error("a column has a stride of 0.");
+		if (offset % 8 != 0 || offset > size || column.count > (size - offset) / column.bytes_per_value) {
+			throw format_error("a column lies outside of the file.");
+		}
+
+		// the columns of one table share the time of their rows
+		if (!table_columns.empty() && table_columns.back().table == column.table) {
+			const Column &previous = table_columns.back();
+			if (previous.count != column.count || previous.stride != column.stride) {
+				throw format_error("the columns of table " + column.table + " have different lengths.");
+			}
+		}
+
+		column.data = map + offset;
+		table_columns.push_back(std::move(column));
+	}
+}
+
+scalar TableFile::Column::value(size_t i) const noexcept {
+	if (bytes_per_value == 4) return static_cast<scalar>(std::bit_cast<float>(read_u32(data + 4 * i)));
+	return static_cast<scalar>(std::bit_cast<double>(read_u64(data + 8 * i)));
+}
+
+std::span<const float> TableFile::Column::as_float32() const {
+	if (std::endian::native != std::endian::little || bytes_per_value != 4) {
+		throw std::runtime_error("The column " + name + " of table " + table + " cannot be read as float32 in place.");
+	}
+	return { reinterpret_cast<const float *>(data), count };
+}
+
+std::span<const double> TableFile::Column::as_float64() const {
+	if (std::endian::native != std::endian::little || bytes_per_value != 8) {
+		throw std::runtime_error("The column " + name + " of table " + table + " cannot be read as float64 in place.");
+	}
+	return { reinterpret_cast<const double *>(data), count };
+}
+
+void TableFile::export_csv(const fs::path &directory, bool verbose) const {
+	for (size_t first = 0; first < table_columns.size();) {
+		size_t last = first + 1;
+		while (last < table_columns.size() && table_columns[last].table == table_columns[first].table) ++last;
+
+		const fs::path filepath = directory / (table_columns[first].table + ".csv");
+		CsvWriter file(filepath);
+
+		file.text("time");
+		for (size_t c = first; c < last; ++c) {
+			file.comma();
+			file.text(table_columns[c].name);
+		}
+		file.end_row();
+
+		for (size_t i = 0; i < table_columns[first].count; ++i) {
+			file.number(time(table_columns[first], i));
+			for (size_t c = first; c < last; ++c) {
+				file.comma();
+				file.number(table_columns[c].value(i));
+			}
+			file.end_row();
+		}
+
+		file.close();
+
+		if (verbose) std::cout << "Exported table " << filepath << std::endl;
+
+		first = last;
+	}
+}
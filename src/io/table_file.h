@@ -0,0 +1,95 @@
+#pragma once
+
+#include "circuit/scalar.h"
+#include "io/mapped_file.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// The binary scope tables (.simtab): a small header with the time base and the column directory,
+// followed by the columns as raw little endian floats, each one aligned to 8 bytes so that a reader
+// can use them straight from the mapped file.
+//
+//   "SLTABLE\0", u32 version, u32 column count, f64 start time, f64 timestep
+//   per column: u32 length + table name, u32 length + column name,
+//               u32 bytes per value (4 or 8), u32 stride, u64 value count, u64 offset of the values
+//
+// Value i of a column is at start time + i * stride * timestep. The columns of one table (one scope)
+// follow each other and are named like the columns of its csv table.
+//
+// JoinedCsv is the csv counterpart, one table with a single time column and the columns of all scopes.
+enum class TableFormat {
+	Csv,
+	JoinedCsv,
+	Float32,
+	Float64,
+};
+
+struct TableColumn {
+	std::string table;
+	std::string name;
+	size_t stride = 1;
+	std::span<const scalar> values;
+	// a last value that is not in values, the unfinished bucket of an envelope
+	std::optional<scalar> pending;
+};
+
+// writes the columns as float32 or float64, throws std::runtime_error when the file cannot be written
+void write_table_file(const fs::path &path, TableFormat format, scalar start_time, scalar timestep, std::span<const TableColumn> columns);
+
+// Writes the columns side by side into one csv table with the time in the first column and the names of the columns
+// in the header. Throws std::runtime_error when the columns do not have the same rows or the file cannot be written.
+void write_joined_csv(const fs::path &path, scalar start_time, scalar timestep, std::span<const TableColumn> columns);
+
+
+// Reads a .simtab file in place from the memory-mapped file.
+class TableFile {
+public:
+	struct Column {
+		std::string table;
+		std::string name;
+		size_t bytes_per_value;
+		size_t stride;
+		size_t count;
+		const std::byte *data;
+
+		// decoded from the file, on any machine
+		scalar value(size_t i) const noexcept;
+
+		// the values as they are in the file, without a copy, throw std::runtime_error on a big endian machine
+		// or when the column has the other type
+		std::span<const float> as_float32() const;
+		std::span<const double> as_float64() const;
+	};
+
+private:
+	MappedFile file;
+
+	scalar start;
+	scalar step;
+	std::vector<Column> table_columns;
+
+public:
+	// throws std::runtime_error when the file cannot be opened or is not a valid table file
+	explicit TableFile(const fs::path &path);
+
+	inline scalar start_time() const noexcept { return start; }
+	inline scalar timestep() const noexcept { return step; }
+	inline const std::vector<Column> &columns() const noexcept { return table_columns; }
+
+	// the time of the value i of the column
+	inline scalar time(const Column &column, size_t i) const noexcept {
+		return start + static_cast<scalar>(i * column.stride) * step;
+	}
+
+	// writes <table>.csv for every table into the directory, the same tables as the csv export
+	void export_csv(const fs::path &directory, bool verbose = true) const;
+};
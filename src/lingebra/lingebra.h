@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <complex>
 #include <concepts>
 #include <cstdint>
 #include <format>
@@ -9,6 +11,7 @@
 #include <iterator>
 #include <limits>
 #include <random>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -166,6 +169,10 @@ template <size_t N> struct is_ModInt<ModInt<N>> : std::true_type {};
 template <class T> inline constexpr bool is_ModInt_v = is_ModInt<T>::value;
 template <class T> concept ModIntLike = is_ModInt_v<T>;
 
+template <class T> struct is_complex : std::false_type {};
+template <class T> struct is_complex<std::complex<T>> : std::true_type {};
+template <class T> inline constexpr bool is_complex_v = is_complex<T>::value;
+
 // "field" concept
 
 template <class T>
@@ -199,6 +206,9 @@ constexpr bool is_zero(const T &a) {
 	else if constexpr (std::floating_point<T>) {
 		return (std::fabs(a) < std::numeric_limits<T>::epsilon());
 	}
+	else if constexpr (is_complex_v<T>) {
+		return (std::abs(a) < std::numeric_limits<typename T::value_type>::epsilon());
+	}
 	else {
 		return (a == make_zero<T>());
 	}
@@ -224,6 +234,18 @@ consteval T make_one() {
 	}
 }
 
+// |a| of real and complex numbers, a real number the pivots can be compared by
+template <class T>
+constexpr auto magnitude(const T &a) {
+	if constexpr (is_complex_v<T>) {
+		return std::abs(a);
+	}
+	else {
+		using std::abs;
+		return static_cast<T>(abs(a));
+	}
+}
+
 template <class T>
 concept additive =
 	requires (T a, T b) { { a + b } -> std::convertible_to<T>; } &&
@@ -301,6 +323,15 @@ public:
 		return data.size();
 	}
 
+	// the elements in place, e.g. to be filled or read without a copy
+	constexpr std::span<F> elements() noexcept {
+		return data;
+	}
+
+	constexpr std::span<const F> elements() const noexcept {
+		return data;
+	}
+
 	constexpr void swap_values(size_t a, size_t b) noexcept(std::is_nothrow_swappable_v<F>) {
 		using std::swap;
 		swap(data[a], data[b]);
@@ -452,8 +483,11 @@ public:
 	}
 
 
+	// fills the matrix with zeros, keeps the allocated rows
 	constexpr void clear() {
-		assign(num_rows, num_cols, zero);
+		for (auto &row : data) {
+			std::fill(row.begin(), row.end(), zero);
+		}
 	}
 
 	constexpr void assign(size_t m, size_t n, const F &value = zero) {
@@ -666,10 +700,10 @@ void solve_gaussian_elimination(Matrix<F> &matrix, Vector<F> &b) {
 	size_t k = 0;
 
 	while (h < m && k < n) {
-		// find k-th pivot
+		// find k-th pivot, the largest by magnitude
 		size_t i_max = h;
 		for (size_t i = h + 1; i < m; ++i) {
-			if (matrix(i, k) > matrix(i_max, k)) i_max = i;
+			if (magnitude(matrix(i, k)) > magnitude(matrix(i_max, k))) i_max = i;
 		}
 		if (is_zero(matrix(i_max, k))) {
 			// no pivot in column => singular matrix
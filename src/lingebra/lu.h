@@ -0,0 +1,270 @@
+#pragma once
+
+#include "lingebra/lingebra.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace lingebra {
+
+// The symbolic part of an LU factorization of a sparse square matrix: the pivot order and the nonzero
+// pattern of the factors including the fill-in. It is computed once by analyze() and then reused
+// by factorize() and solve() for every matrix with the same pattern, only the values may differ.
+class LUPlan {
+public:
+	struct Pivot {
+		size_t row;
+		size_t col;
+
+		// rows eliminated by this pivot, they have a nonzero in the pivot column
+		std::vector<size_t> rows;
+		// nonzero columns of the pivot row except the pivot column, all of them are eliminated later
+		std::vector<size_t> cols;
+	};
+
+private:
+	size_t n;
+	std::vector<Pivot> pivots;
+
+	// n * n flags of the nonzero positions of the factors, positions outside it stay zero
+	std::vector<char> mask;
+	std::vector<std::pair<size_t, size_t>> positions;
+
+	LUPlan(size_t n) : n(n), mask(n * n, 0) {}
+
+public:
+	// Chooses the pivots by the Markowitz count (fewest fill-ins) among the entries that are at least
+	// threshold times the largest entry of their column. The structure flags the positions that
+	// may be nonzero (n * n, row-major), the values of the matrix are used only for the threshold.
+	// Throws singular_matrix_exception when the matrix is singular.
+	template <field F>
+	static LUPlan analyze(const Matrix<F> &matrix, const std::vector<char> &structure, double threshold = 0.1);
+
+	// Factorizes the matrix in place, the matrix must be zero outside the pattern.
+	// Returns false when a pivot became too small for these values, the matrix has to be analyzed again.
+	template <field F>
+	bool factorize(Matrix<F> &matrix, double tolerance = 1e-3) const;
+
+	// Solves the system with the factorized matrix, b is overwritten by the intermediate results.
+	template <field F>
+	void solve(const Matrix<F> &lu, Vector<F> &b, Vector<F> &x) const;
+
+	inline size_t dim() const noexcept { return n; }
+
+	inline bool contains(size_t row, size_t col) const noexcept { return mask[row * n + col] != 0; }
+
+	// all nonzero positions of the factors
+	inline const std::vector<std::pair<size_t, size_t>> &get_positions() const noexcept { return positions; }
+
+	inline const std::vector<char> &get_mask() const noexcept { return mask; }
+
+	// Stores the plan in a checkpoint, so that a restored circuit keeps factorizing with the same pivots.
+	// The writer and the reader are CheckpointWriter and CheckpointReader, only their size lists are used.
+	template <class Writer>
+	void save(Writer &out) const;
+	template <class Reader>
+	static LUPlan load(Reader &in);
+};
+
+
+template <class Writer>
+void LUPlan::save(Writer &out) const {
+	out.write_size(n);
+
+	out.write_size(pivots.size());
+	for (const auto &pivot : pivots) {
+		out.write_size(pivot.row);
+		out.write_size(pivot.col);
+		out.write_sizes(pivot.rows);
+		out.write_sizes(pivot.cols);
+	}
+
+	std::vector<size_t> flat;
+	flat.reserve(2 * positions.size());
+	for (const auto &[row, col] : positions) {
+		flat.push_back(row);
+		flat.push_back(col);
+	}
+	out.write_sizes(flat);
+}
+
+template <class Reader>
+LUPlan LUPlan::load(Reader &in) {
+	LUPlan plan(in.read_size());
+	const size_t n = plan.n;
+
+	const auto check = [n](size_t index) {
+		if (index >= n) throw std::runtime_error("Invalid index in a stored LUPlan");
+		return index;
+	};
+
+	plan.pivots.resize(in.read_size());
+	for (auto &pivot : plan.pivots) {
+		pivot.row = check(in.read_size());
+		pivot.col = check(in.read_size());
+		pivot.rows = in.read_sizes();
+		pivot.cols = in.read_sizes();
+		for (size_t row : pivot.rows) check(row);
+		for (size_t col : pivot.cols) check(col);
+	}
+	if (plan.pivots.size() != n) throw std::runtime_error("Invalid number of pivots in a stored LUPlan");
+
+	// the mask is the set of the positions
+	const auto flat = in.read_sizes();
+	for (size_t i = 0; i + 1 < flat.size(); i += 2) {
+		const size_t row = check(flat[i]);
+		const size_t col = check(flat[i + 1]);
+		plan.positions.emplace_back(row, col);
+		plan.mask[row * n + col] = 1;
+	}
+
+	return plan;
+}
+
+
+template <field F>
+LUPlan LUPlan::analyze(const Matrix<F> &matrix, const std::vector<char> &structure, double threshold) {
+	using M = decltype(magnitude(std::declval<F>()));
+
+	const size_t n = matrix.n();
+	if (matrix.m() != n || structure.size() != n * n) {
+		throw std::runtime_error("Size mismatch in LUPlan::analyze");
+	}
+
+	LUPlan plan(n);
+	plan.mask = structure;
+
+	// eliminate a copy of the matrix to follow the values and the fill-in
+	Matrix<F> a(matrix);
+	std::vector<char> row_done(n, 0);
+	std::vector<char> col_done(n, 0);
+	std::vector<size_t> row_count(n);
+	std::vector<size_t> col_count(n);
+	std::vector<M> col_max(n);
+
+	for (size_t k = 0; k < n; ++k) {
+		std::fill(row_count.begin(), row_count.end(), 0);
+		std::fill(col_count.begin(), col_count.end(), 0);
+		std::fill(col_max.begin(), col_max.end(), make_zero<M>());
+
+		for (size_t i = 0; i < n; ++i) {
+			if (row_done[i]) continue;
+			for (size_t j = 0; j < n; ++j) {
+				if (col_done[j] || !plan.contains(i, j)) continue;
+				++row_count[i];
+				++col_count[j];
+				col_max[j] = std::max(col_max[j], magnitude(a(i, j)));
+			}
+		}
+
+		// the cheapest acceptable pivot, ties go to the larger value
+		size_t best_row = n, best_col = n;
+		size_t best_cost = 0;
+		M best_value = make_zero<M>();
+
+		for (size_t i = 0; i < n; ++i) {
+			if (row_done[i]) continue;
+			for (size_t j = 0; j < n; ++j) {
+				if (col_done[j] || !plan.contains(i, j)) continue;
+
+				M value = magnitude(a(i, j));
+				if (is_zero(value) || value < threshold * col_max[j]) continue;
+
+				size_t cost = (row_count[i] - 1) * (col_count[j] - 1);
+				if (best_row == n || cost < best_cost || (cost == best_cost && value > best_value)) {
+					best_row = i;
+					best_col = j;
+					best_cost = cost;
+					best_value = value;
+				}
+			}
+		}
+
+		if (best_row == n) {
+			throw singular_matrix_exception();
+		}
+
+		Pivot pivot{ .row = best_row, .col = best_col, .rows = {}, .cols = {} };
+		row_done[best_row] = 1;
+		col_done[best_col] = 1;
+
+		for (size_t i = 0; i < n; ++i) {
+			if (!row_done[i] && plan.contains(i, best_col)) pivot.rows.push_back(i);
+		}
+		for (size_t j = 0; j < n; ++j) {
+			if (!col_done[j] && plan.contains(best_row, j)) pivot.cols.push_back(j);
+		}
+
+		for (size_t i : pivot.rows) {
+			F f = a(i, best_col) / a(best_row, best_col);
+			for (size_t j : pivot.cols) {
+				a(i, j) -= f * a(best_row, j);
+				plan.mask[i * n + j] = 1;
+			}
+		}
+
+		plan.pivots.push_back(std::move(pivot));
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			if (plan.contains(i, j)) plan.positions.emplace_back(i, j);
+		}
+	}
+
+	return plan;
+}
+
+template <field F>
+bool LUPlan::factorize(Matrix<F> &matrix, double tolerance) const {
+	using M = decltype(magnitude(std::declval<F>()));
+
+	for (const Pivot &pivot : pivots) {
+		const F value = matrix(pivot.row, pivot.col);
+
+		M largest = make_zero<M>();
+		for (size_t i : pivot.rows) {
+			largest = std::max(largest, magnitude(matrix(i, pivot.col)));
+		}
+		if (is_zero(value) || magnitude(value) < tolerance * largest) return false;
+
+		const F inv = make_one<F>() / value;
+
+		// the multipliers of L are stored in place of the eliminated entries
+		for (size_t i : pivot.rows) {
+			F f = matrix(i, pivot.col) * inv;
+			matrix(i, pivot.col) = f;
+			for (size_t j : pivot.cols) {
+				matrix(i, j) -= f * matrix(pivot.row, j);
+			}
+		}
+	}
+
+	return true;
+}
+
+template <field F>
+void LUPlan::solve(const Matrix<F> &lu, Vector<F> &b, Vector<F> &x) const {
+	// forward substitution, in the pivot order
+	for (const Pivot &pivot : pivots) {
+		const F value = b[pivot.row];
+		for (size_t i : pivot.rows) {
+			b[i] -= lu(i, pivot.col) * value;
+		}
+	}
+
+	// back substitution, every pivot row only references the columns eliminated after it
+	for (size_t k = pivots.size(); k-- > 0;) {
+		const Pivot &pivot = pivots[k];
+
+		F sum = b[pivot.row];
+		for (size_t j : pivot.cols) {
+			sum -= lu(pivot.row, j) * x[j];
+		}
+		x[pivot.col] = sum / lu(pivot.row, pivot.col);
+	}
+}
+}
@@ -2,6 +2,7 @@
 
 #include "settings.h"
 
+#include "batch/batch_runner.h"
 #include "circuit/circuit.h"
 #include "circuit/interpreter/interpreter.h"
 #include "circuit/parts/capacitor.h"
@@ -9,6 +10,11 @@
 #include "circuit/parts/switch.h"
 #include "circuit/parts/voltage_source.h"
 #include "circuit/scalar.h"
+#include "circuit/scope.h"
+#include "io/table_file.h"
+#include "stream/realtime_streamer.h"
+#include "stream/sink.h"
+#include "system/circuit_system.h"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -29,12 +35,136 @@ int main(int argc, char *argv[]) {
 	if (settings.exit) return settings.exit_code;
 
 
+	AdaptiveSettings adaptive_settings;
+	adaptive_settings.tolerance.relative = settings.tolerance;
+
+	Scope::Decimation scope_decimation;
+	if (settings.scope_every > 0) scope_decimation = { .mode = Scope::Decimation::Mode::Every, .factor = settings.scope_every };
+	if (settings.scope_envelope > 0) scope_decimation = { .mode = Scope::Decimation::Mode::Envelope, .factor = settings.scope_envelope };
+
+	// patch files describe a system of multiple circuits
+	if (settings.circuit_path.extension() == ".simpatch") {
+		try {
+			if (!settings.stream_sink.empty()) {
+				throw std::runtime_error("Streaming is not supported for patch files.");
+			}
+			if (settings.pss_period > 0.0) {
+				throw std::runtime_error("The periodic steady state is not supported for patch files.");
+			}
+			if (settings.ac_points > 0) {
+				throw std::runtime_error("The ac analysis is not supported for patch files.");
+			}
+			if (!settings.resume_path.empty() || !settings.checkpoint_path.empty()) {
+				throw std::runtime_error("Checkpoints are not supported for patch files.");
+			}
+
+			CircuitSystem system(1.0_s / settings.samplerate, settings.block_size, settings.tables_path);
+			system.set_adaptive(settings.adaptive, adaptive_settings);
+			system.set_integration_method(settings.method);
+			system.set_oversampling(settings.oversampling);
+			system.set_start_from_operating_point(settings.operating_point);
+			system.set_scope_decimation(scope_decimation);
+			system.set_table_streaming(settings.table_chunk_size);
+			system.set_table_format(settings.table_format);
+
+			system.load_patch(settings.circuit_path);
+			system.run_for_seconds(settings.duration);
+
+			if (settings.export_tables) system.export_tables();
+			if (settings.show_graphs) system.show_graphs();
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
+	// binary tables are converted back into csv tables next to them
+	if (settings.circuit_path.extension() == ".simtab") {
+		try {
+			TableFile tables(settings.circuit_path);
+			tables.export_csv(settings.circuit_path.parent_path());
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
+	// batch files run many circuits and parameter sweeps in parallel
+	if (settings.circuit_path.extension() == ".simbatch") {
+		try {
+			if (!settings.stream_sink.empty()) {
+				throw std::runtime_error("Streaming is not supported for batch files.");
+			}
+			if (settings.ac_points > 0) {
+				throw std::runtime_error("The ac analysis is not supported for batch files.");
+			}
+			if (!settings.checkpoint_path.empty()) {
+				throw std::runtime_error("Saving a checkpoint is not supported for batch files, they can start from one.");
+			}
+
+			BatchRunner batch(1.0_s / settings.samplerate, settings.duration, settings.tables_path, settings.jobs);
+			batch.set_adaptive(settings.adaptive, adaptive_settings);
+			batch.set_integration_method(settings.method);
+			batch.set_oversampling(settings.oversampling);
+			batch.set_start_from_operating_point(settings.operating_point);
+			batch.set_scope_decimation(scope_decimation);
+			batch.set_table_streaming(settings.table_chunk_size);
+			batch.set_table_format(settings.table_format);
+			batch.set_periodic_steady_state(settings.pss_period);
+			batch.set_start_checkpoint(settings.resume_path);
+
+			batch.load_manifest(settings.circuit_path);
+			size_t failed = batch.run();
+
+			if (failed != 0) return 1;
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
 	Circuit circuit(1.0_s / settings.samplerate, settings.tables_path);
 
 	try {
 		circuit.load_circuit(settings.circuit_path);
-		circuit.run_for_seconds(settings.duration);
+		circuit.set_adaptive(settings.adaptive, adaptive_settings);
+		circuit.set_integration_method(settings.method);
+		circuit.set_oversampling(settings.oversampling);
+		circuit.set_start_from_operating_point(settings.operating_point);
+		circuit.set_scope_decimation(scope_decimation);
+		circuit.set_table_streaming(settings.table_chunk_size);
+		circuit.set_table_format(settings.table_format);
+		if (!settings.resume_path.empty()) circuit.load_checkpoint(settings.resume_path);
+		if (settings.pss_period > 0.0) circuit.find_periodic_steady_state(settings.pss_period);
+		if (settings.ac_points > 0) circuit.run_ac_sweep(settings.ac_from, settings.ac_to, settings.ac_points, settings.jobs);
+
+		if (!settings.stream_sink.empty()) {
+			auto sink = make_sink(settings.stream_sink, settings.stream_path, circuit.output_count(), settings.samplerate);
+			RealtimeStreamer streamer(circuit, *sink, settings.block_size);
+
+			std::cout << "Streaming " << circuit.output_count() << " outputs into the " << settings.stream_sink << " sink" << std::endl;
+			auto report = streamer.run_for_seconds(settings.duration);
+
+			std::cout << "Streamed " << report.frames << " frames in " << report.wall_seconds << "s\n"
+				<< "Underruns: " << report.underruns << " (" << report.underrun_frames << " frames of silence)\n"
+				<< "Real-time factor: " << report.realtime_factor << "x" << std::endl;
+		}
+		else if (settings.duration > 0.0) {
+			circuit.run_for_seconds(settings.duration);
+		}
+
+		if (!settings.checkpoint_path.empty()) circuit.save_checkpoint(settings.checkpoint_path);
 
+		circuit.print_measurements();
 		if (settings.export_tables) circuit.export_tables();
 		if (settings.show_graphs) circuit.show_graphs();
 	}
@@ -1,8 +1,10 @@
 #include "settings.h"
 
+#include "circuit/integration.h"
 #include "circuit/interpreter/interpreter.h"
 #include "version.h"
 
+#include <charconv>
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -19,6 +21,9 @@ static void print_help() {
 		<< "  simlogue [options] circuit_file duration\n\n"
 
 		<< "  circuit_file       .simlog file to load the circuit from\n"
+		<< "                     or .simpatch file to load a system of circuits from\n"
+		<< "                     or .simbatch file with many runs and parameter sweeps\n"
+		<< "                     or .simtab binary tables to convert to csv tables\n"
 		<< "  duration           Time value (see readme) specifying the run time\n\n"
 
 		<< "Options:\n"
@@ -29,7 +34,40 @@ static void print_help() {
 		<< "  -r, --samplerate <freq>   Sets the samplerate in Hz\n"
 		<< "                            (default: 44100_Hz)\n"
 		<< "  -e, --export-tables       Exports the scope tables\n"
-		<< "  -g, --show-graphs         Displays the scope graphs after run\n\n"
+		<< "      --stream-tables       Exports the scope tables while running, so that\n"
+		<< "                            long runs do not keep them in memory\n"
+		<< "      --table-format <fmt>  Format of the exported tables: csv, joined for one\n"
+		<< "                            scopes.csv with a shared time column, or f32 or f64\n"
+		<< "                            for one binary tables.simtab (default: csv)\n"
+		<< "  -g, --show-graphs         Displays the scope graphs after run\n"
+		<< "  -s, --stream     <sink>   Streams the circuit outputs in real time\n"
+		<< "                            into a sink: null, raw or wav\n"
+		<< "      --stream-file <path>  File for the raw or wav sink\n"
+		<< "                            (default: ./stream.raw or ./stream.wav)\n"
+		<< "  -b, --block-size <n>      Frames per streamed block and per block\n"
+		<< "                            exchanged between patch modules (default: 256)\n"
+		<< "  -j, --jobs       <n>      Parallel runs of a batch file or threads of the\n"
+		<< "                            ac analysis\n"
+		<< "                            (default: number of hardware threads)\n"
+		<< "  -a, --adaptive            Adaptive internal timestep, the samplerate\n"
+		<< "                            only sets the rate of the scopes and outputs\n"
+		<< "      --tolerance <value>   Relative error of an adaptive step (default: 0.001)\n"
+		<< "  -m, --method     <name>   Integration of capacitors and inductors:\n"
+		<< "                            euler, trap or gear2 (default: euler)\n"
+		<< "  -o, --oversample <n>      Internal steps per sample, the scopes and outputs\n"
+		<< "                            are decimated to the samplerate (default: 1)\n"
+		<< "      --scope-every <n>     The scopes keep every n-th sample only\n"
+		<< "      --scope-envelope <n>  The scopes keep the min, max and mean of every\n"
+		<< "                            n samples\n"
+		<< "      --op                  Start from the dc operating point instead of\n"
+		<< "                            discharged capacitors and inductors\n"
+		<< "      --pss <period>        Start from the periodic steady state of the\n"
+		<< "                            given period, found by the shooting method\n"
+		<< "      --ac <from> <to> <n>  Ac analysis at n frequencies spaced logarithmically,\n"
+		<< "                            the duration is optional then\n"
+		<< "      --resume <path>       Continue from a checkpoint, the duration is added\n"
+		<< "                            to the time of the checkpoint\n"
+		<< "      --checkpoint <path>   Save a checkpoint of the state after the run\n\n"
 		;
 }
 
@@ -61,6 +99,27 @@ Settings handle_args(int argc, char *argv[]) {
 		else if (accept_options && (option == "-e" || option == "--export-tables")) {
 			settings.export_tables = true;
 		}
+		else if (accept_options && option == "--stream-tables") {
+			settings.export_tables = true;
+			settings.table_chunk_size = 4096;
+		}
+		else if (accept_options && option == "--table-format") {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <fmt> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			std::string_view argument = argv[i];
+			if (argument == "csv") settings.table_format = TableFormat::Csv;
+			else if (argument == "joined") settings.table_format = TableFormat::JoinedCsv;
+			else if (argument == "f32") settings.table_format = TableFormat::Float32;
+			else if (argument == "f64") settings.table_format = TableFormat::Float64;
+			else {
+				std::cout << "Argument <fmt> must be one of csv, joined, f32 or f64.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
 		else if (accept_options && (option == "-g" || option == "--show_graphs")) {
 			settings.show_graphs = true;
 		}
@@ -73,6 +132,204 @@ Settings handle_args(int argc, char *argv[]) {
 			std::string argument = argv[i];
 			settings.tables_path = fs::path(argument);
 		}
+		else if (accept_options && (option == "-s" || option == "--stream")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <sink> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			settings.stream_sink = argv[i];
+			if (settings.stream_sink != "null" && settings.stream_sink != "raw" && settings.stream_sink != "wav") {
+				std::cout << "Argument <sink> must be one of null, raw or wav.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && option == "--stream-file") {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <path> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			settings.stream_path = fs::path(argv[i]);
+		}
+		else if (accept_options && (option == "--resume" || option == "--checkpoint")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <path> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			if (option == "--resume") settings.resume_path = fs::path(argv[i]);
+			else settings.checkpoint_path = fs::path(argv[i]);
+		}
+		else if (accept_options && (option == "-b" || option == "--block-size")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <n> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			std::string_view argument = argv[i];
+			auto [ptr, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), settings.block_size);
+			if (ec != std::errc() || ptr != argument.data() + argument.size() || settings.block_size == 0) {
+				std::cout << "Argument <n> must be a positive integer.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && (option == "-j" || option == "--jobs")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <n> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			std::string_view argument = argv[i];
+			auto [ptr, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), settings.jobs);
+			if (ec != std::errc() || ptr != argument.data() + argument.size() || settings.jobs == 0) {
+				std::cout << "Argument <n> must be a positive integer.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && (option == "-m" || option == "--method")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <name> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			auto method = integration_method_from_string(argv[i]);
+			if (!method) {
+				std::cout << "Argument <name> must be one of euler, trap or gear2.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			settings.method = *method;
+		}
+		else if (accept_options && (option == "-o" || option == "--oversample")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <n> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			std::string_view argument = argv[i];
+			auto [ptr, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), settings.oversampling);
+			if (ec != std::errc() || ptr != argument.data() + argument.size() || settings.oversampling == 0) {
+				std::cout << "Argument <n> must be a positive integer.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && (option == "--scope-every" || option == "--scope-envelope")) {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <n> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			size_t factor = 0;
+			std::string_view argument = argv[i];
+			auto [ptr, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), factor);
+			if (ec != std::errc() || ptr != argument.data() + argument.size() || factor == 0) {
+				std::cout << "Argument <n> must be a positive integer.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			// the last one of them wins
+			settings.scope_every = option == "--scope-every" ? factor : 0;
+			settings.scope_envelope = option == "--scope-envelope" ? factor : 0;
+		}
+		else if (accept_options && (option == "-a" || option == "--adaptive")) {
+			settings.adaptive = true;
+		}
+		else if (accept_options && option == "--op") {
+			settings.operating_point = true;
+		}
+		else if (accept_options && option == "--tolerance") {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <value> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			try {
+				auto [quantity, tolerance] = Interpreter::parse_value(argv[i], "in param tolerance");
+
+				if (quantity != Quantity::None) {
+					throw ParseError(std::format("Value error in param tolerance: Tolerance has to be a value without unit, got value of type '{}'.", quantity_to_string(quantity)));
+				}
+
+				settings.tolerance = tolerance;
+			}
+			catch (const std::exception &e) {
+				std::cout << e.what() << "\nSee help: \n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			if (settings.tolerance <= 0.0) {
+				std::cout << "Argument <value> must be positive.\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && option == "--pss") {
+			if (++i >= argc) {
+				std::cout << "Option " << option << " requires <period> argument.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			try {
+				auto [quantity, period] = Interpreter::parse_value(argv[i], "in param period");
+
+				if (quantity != Quantity::Time) {
+					throw ParseError(std::format("Value error in param period: Period has to be a time value, got value of type '{}'.", quantity_to_string(quantity)));
+				}
+
+				settings.pss_period = period;
+			}
+			catch (const std::exception &e) {
+				std::cout << e.what() << "\nSee help: \n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			if (settings.pss_period <= 0.0) {
+				std::cout << "Argument <period> must be positive.\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
+		else if (accept_options && option == "--ac") {
+			if (i + 3 >= argc) {
+				std::cout << "Option " << option << " requires <from> <to> <n> arguments.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			try {
+				auto [from_quantity, from] = Interpreter::parse_value(argv[++i], "in param from");
+				auto [to_quantity, to] = Interpreter::parse_value(argv[++i], "in param to");
+
+				if (from_quantity != Quantity::Frequency || to_quantity != Quantity::Frequency) {
+					throw ParseError("Value error in param from/to: The bounds of the ac analysis have to be frequency values.");
+				}
+
+				settings.ac_from = from;
+				settings.ac_to = to;
+			}
+			catch (const std::exception &e) {
+				std::cout << e.what() << "\nSee help: \n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+
+			std::string_view argument = argv[++i];
+			auto [ptr, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), settings.ac_points);
+			if (ec != std::errc() || ptr != argument.data() + argument.size() || settings.ac_points == 0) {
+				std::cout << "Argument <n> must be a positive integer.\nSee help:\n\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+			if (settings.ac_from <= 0.0 || settings.ac_to <= 0.0) {
+				std::cout << "Arguments <from> and <to> must be positive.\n";
+				print_help();
+				return Settings{ .exit = true, .exit_code = 2 };
+			}
+		}
 		else if (accept_options && (option == "-r" || option == "--samplerate")) {
 			if (++i >= argc) {
 				std::cout << "Option " << option << " requires <freq> argument.\nSee help:\n\n";
@@ -149,11 +406,27 @@ Settings handle_args(int argc, char *argv[]) {
 		print_help();
 		return Settings{ .exit = true, .exit_code = 2 };
 	}
-	if (!read_duration) {
+	// converting the tables does not simulate
+	if (!read_duration && settings.ac_points == 0 && settings.circuit_path.extension() != ".simtab") {
 		std::cout << "SimLogue requires the duration.\nSee help:\n\n";
 		print_help();
 		return Settings{ .exit = true, .exit_code = 2 };
 	}
 
+	if (settings.table_chunk_size > 0 && settings.table_format != TableFormat::Csv) {
+		std::cout << "Only the csv tables of the scopes can be streamed, --stream-tables cannot be used with another --table-format.\nSee help:\n\n";
+		print_help();
+		return Settings{ .exit = true, .exit_code = 2 };
+	}
+	if (settings.table_chunk_size > 0 && settings.show_graphs) {
+		std::cout << "The graphs need the whole recording, they cannot be shown with --stream-tables.\nSee help:\n\n";
+		print_help();
+		return Settings{ .exit = true, .exit_code = 2 };
+	}
+
+	if (settings.stream_path.empty()) {
+		settings.stream_path = settings.stream_sink == "wav" ? fs::path("./stream.wav") : fs::path("./stream.raw");
+	}
+
 	return settings;
 }
\ No newline at end of file
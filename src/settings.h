@@ -1,8 +1,11 @@
 #pragma once
 
+#include "circuit/integration.h"
 #include "circuit/scalar.h"
+#include "io/table_file.h"
 
 #include <filesystem>
+#include <string>
 
 
 namespace fs = std::filesystem;
@@ -15,7 +18,26 @@ struct Settings {
 	scalar samplerate = 44100.0;
 	fs::path circuit_path = fs::path("");
 	bool export_tables = false;
+	TableFormat table_format = TableFormat::Csv;
+	size_t table_chunk_size = 0; // rows per chunk of the tables written during the run, 0 when they are written after it
 	bool show_graphs = false;
+	std::string stream_sink = ""; // empty when not streaming
+	fs::path stream_path = fs::path("");
+	size_t block_size = 256;
+	size_t jobs = 0; // 0 uses all hardware threads
+	bool adaptive = false;
+	scalar tolerance = 1e-3; // relative error of an adaptive step
+	IntegrationMethod method = IntegrationMethod::BackwardEuler;
+	size_t oversampling = 1;
+	size_t scope_every = 0; // keep every n-th sample in the scopes, 0 when not
+	size_t scope_envelope = 0; // keep the min, max and mean of every n samples in the scopes, 0 when not
+	bool operating_point = false; // start from the dc operating point instead of zero
+	scalar pss_period = 0.0; // start from the periodic steady state with this period, 0 when not
+	scalar ac_from = 0.0;
+	scalar ac_to = 0.0;
+	size_t ac_points = 0; // 0 when there is no ac analysis
+	fs::path resume_path = fs::path(""); // the checkpoint to start from, empty when not
+	fs::path checkpoint_path = fs::path(""); // the checkpoint to save after the run, empty when not
 };
 
 Settings handle_args(int argc, char *argv[]);
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "stream/realtime_streamer.h"
+
+#include "circuit/circuit.h"
+#include "circuit/scalar.h"
+#include "stream/sink.h"
+#include "stream/spsc_ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+RealtimeStreamer::RealtimeStreamer(Circuit &circuit, AudioSink &sink, size_t block_size, size_t buffer_blocks) :
+	circuit(circuit),
+	sink(sink),
+	block_size(block_size),
+	buffer_blocks(buffer_blocks) {
+	if (block_size == 0) throw std::invalid_argument("The block size must be positive.");
+	if (buffer_blocks < 2) throw std::invalid_argument("The stream buffer must hold at least two blocks.");
+}
+
+StreamReport RealtimeStreamer::run_for_steps(size_t num_steps) {
+	using clock = std::chrono::steady_clock;
+
+	const size_t channels = circuit.output_count();
+	if (channels == 0) {
+		throw std::runtime_error("Error: Streaming requires at least one output, declare it using 'output <name>: <probe>'.");
+	}
+
+	circuit.prepare();
+
+	SpscRingBuffer<float> ring(block_size * buffer_blocks * channels);
+	const size_t prefill_frames = ring.capacity() / channels / 2;
+
+	const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(block_size * circuit.get_timestep()));
+
+	std::atomic<bool> producer_done = false;
+	std::atomic<bool> consumer_done = false;
+	std::exception_ptr producer_error = nullptr;
+	std::exception_ptr consumer_error = nullptr;
+
+	StreamReport report;
+
+	auto start = clock::now();
+
+	std::jthread producer([&] {
+		try {
+			// the inputs are held at zero, each output gets its own channel
+			std::vector<scalar> silence(block_size, 0.0);
+			std::vector<std::vector<scalar>> channel_buffers(channels, std::vector<scalar>(block_size));
+			std::vector<float> interleaved(block_size * channels);
+
+			std::vector<std::span<const scalar>> inputs(circuit.input_count(), silence);
+			std::vector<std::span<scalar>> outputs(channel_buffers.begin(), channel_buffers.end());
+
+			clock::duration busy{ 0 };
+
+			for (size_t produced = 0; produced < num_steps;) {
+				const size_t n = std::min(block_size, num_steps - produced);
+
+				auto block_start = clock::now();
+				circuit.process_block(n, inputs, outputs);
+				busy += clock::now() - block_start;
+
+				for (size_t frame = 0; frame < n; ++frame) {
+					for (size_t channel = 0; channel < channels; ++channel) {
+						interleaved[frame * channels + channel] = static_cast<float>(channel_buffers[channel][frame]);
+					}
+				}
+
+				// wait for the consumer to make room, the simulation never drops samples. Only whole frames are pushed,
+				// the capacity of the ring need not be a multiple of the channels.
+				std::span<const float> pending(interleaved.data(), n * channels);
+				while (!pending.empty()) {
+					const size_t frames = std::min(pending.size(), ring.free_space()) / channels;
+					pending = pending.subspan(ring.push(pending.first(frames * channels)));
+					if (pending.empty()) break;
+					if (consumer_done) return;
+					std::this_thread::sleep_for(period / 8);
+				}
+
+				produced += n;
+			}
+
+			report.busy_seconds = std::chrono::duration<double>(busy).count();
+		}
+		catch (...) {
+			producer_error = std::current_exception();
+		}
+		producer_done = true;
+	});
+
+	std::jthread consumer([&] {
+		try {
+			std::vector<float> block(block_size * channels);
+
+			// let the simulation get ahead before the playback starts
+			while (!producer_done && ring.size() / channels < prefill_frames) {
+				std::this_thread::sleep_for(period / 8);
+			}
+
+			auto deadline = clock::now();
+
+			while (true) {
+				deadline += period;
+				std::this_thread::sleep_until(deadline);
+
+				// read the flag first, so that no samples pushed before it was set are missed
+				const bool finished = producer_done;
+
+				const size_t available = std::min(block.size(), ring.size()) / channels;
+				size_t popped = ring.pop(std::span<float>(block).first(available * channels)) / channels;
+
+				if (finished && popped == 0) break;
+
+				if (popped < block_size && !finished) {
+					++report.underruns;
+					report.underrun_frames += block_size - popped;
+					std::fill(block.begin() + popped * channels, block.end(), 0.0f);
+					popped = block_size;
+				}
+
+				sink.write(std::span<const float>(block.data(), popped * channels));
+				report.frames += popped;
+			}
+		}
+		catch (...) {
+			consumer_error = std::current_exception();
+		}
+		consumer_done = true;
+	});
+
+	producer.join();
+	consumer.join();
+
+	sink.close();
+
+	report.wall_seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	if (producer_error) std::rethrow_exception(producer_error);
+	if (consumer_error) std::rethrow_exception(consumer_error);
+
+	const double simulated_seconds = num_steps * circuit.get_timestep();
+	report.realtime_factor = report.busy_seconds > 0.0 ? simulated_seconds / report.busy_seconds : 0.0;
+
+	return report;
+}
+
+StreamReport RealtimeStreamer::run_for_seconds(scalar secs) {
+	return run_for_steps(static_cast<size_t>(secs / circuit.get_timestep()));
+}
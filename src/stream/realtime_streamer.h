@@ -0,0 +1,37 @@
+#pragma once
+
+#include "circuit/circuit.h"
+#include "stream/sink.h"
+
+#include <cstddef>
+
+
+struct StreamReport {
+	size_t frames = 0;          // frames written to the sink, including the silence
+	size_t underruns = 0;       // periods in which the simulation did not deliver a full block in time
+	size_t underrun_frames = 0; // frames replaced by silence
+	double wall_seconds = 0.0;
+	double busy_seconds = 0.0;  // time the simulation thread spent simulating
+
+	// simulated seconds per second of simulation work, it has to stay above 1 to run in real time
+	double realtime_factor = 0.0;
+};
+
+// Runs the circuit on a dedicated simulation thread, which pushes the circuit outputs (one channel each)
+// into a lock-free ring buffer. A consumer thread drains the buffer at the wall-clock rate into the sink,
+// writing silence whenever the simulation falls behind. The circuit inputs are driven with zeros.
+class RealtimeStreamer {
+private:
+	Circuit &circuit;
+	AudioSink &sink;
+
+	size_t block_size;
+	size_t buffer_blocks;
+
+public:
+	// the ring buffer holds buffer_blocks blocks, the playback starts once it is half full
+	RealtimeStreamer(Circuit &circuit, AudioSink &sink, size_t block_size = 256, size_t buffer_blocks = 8);
+
+	StreamReport run_for_steps(size_t num_steps);
+	StreamReport run_for_seconds(scalar secs);
+};
@@ -0,0 +1,110 @@
+#include "stream/sink.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+
+// the output files are little-endian, so the samples are byte swapped on big-endian machines
+static void write_samples_le(std::ofstream &file, std::span<const float> samples) {
+	if constexpr (std::endian::native == std::endian::little) {
+		file.write(reinterpret_cast<const char *>(samples.data()), static_cast<std::streamsize>(samples.size_bytes()));
+	}
+	else {
+		for (float sample : samples) {
+			auto bytes = std::bit_cast<std::array<char, sizeof(float)>>(sample);
+			std::reverse(bytes.begin(), bytes.end());
+			file.write(bytes.data(), bytes.size());
+		}
+	}
+}
+
+template <class T>
+static void write_le(std::ofstream &file, T value) {
+	std::array<char, sizeof(T)> bytes{};
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+	}
+	file.write(bytes.data(), bytes.size());
+}
+
+
+RawSink::RawSink(const fs::path &path) : file(path, std::ios::binary) {
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open output file: " + path.string());
+	}
+}
+
+void RawSink::write(std::span<const float> samples) {
+	write_samples_le(file, samples);
+}
+
+void RawSink::close() {
+	file.close();
+}
+
+
+WavSink::WavSink(const fs::path &path, size_t channels, scalar samplerate) :
+	file(path, std::ios::binary),
+	channels(static_cast<uint16_t>(channels)),
+	samplerate(static_cast<uint32_t>(samplerate)),
+	data_bytes(0) {
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open output file: " + path.string());
+	}
+	if (channels == 0 || channels > std::numeric_limits<uint16_t>::max()) {
+		throw std::runtime_error(std::format("Invalid number of WAV channels: {}.", channels));
+	}
+
+	// placeholder sizes, rewritten on close
+	write_header();
+}
+
+void WavSink::write_header() {
+	constexpr uint16_t format_ieee_float = 3;
+	constexpr uint16_t bytes_per_sample = sizeof(float);
+
+	// the sizes are limited to 32 bits by the format
+	const uint32_t data_size = static_cast<uint32_t>(std::min<uint64_t>(data_bytes, std::numeric_limits<uint32_t>::max() - 36));
+
+	file.write("RIFF", 4);
+	write_le<uint32_t>(file, 36 + data_size);
+	file.write("WAVE", 4);
+
+	file.write("fmt ", 4);
+	write_le<uint32_t>(file, 16);
+	write_le<uint16_t>(file, format_ieee_float);
+	write_le<uint16_t>(file, channels);
+	write_le<uint32_t>(file, samplerate);
+	write_le<uint32_t>(file, samplerate * channels * bytes_per_sample);
+	write_le<uint16_t>(file, static_cast<uint16_t>(channels * bytes_per_sample));
+	write_le<uint16_t>(file, 8 * bytes_per_sample);
+
+	file.write("data", 4);
+	write_le<uint32_t>(file, data_size);
+}
+
+void WavSink::write(std::span<const float> samples) {
+	write_samples_le(file, samples);
+	data_bytes += samples.size_bytes();
+}
+
+void WavSink::close() {
+	if (!file.is_open()) return;
+
+	file.seekp(0);
+	write_header();
+	file.close();
+}
+
+
+std::unique_ptr<AudioSink> make_sink(std::string_view type, const fs::path &path, size_t channels, scalar samplerate) {
+	if (type == "null") return std::make_unique<NullSink>();
+	if (type == "raw") return std::make_unique<RawSink>(path);
+	if (type == "wav") return std::make_unique<WavSink>(path, channels, samplerate);
+
+	throw std::runtime_error(std::format("Unknown stream sink '{}', expected 'null', 'raw' or 'wav'.", type));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "circuit/scalar.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string_view>
+
+
+namespace fs = std::filesystem;
+
+
+// Receives the streamed samples, interleaved by channel.
+class AudioSink {
+public:
+	virtual ~AudioSink() = default;
+
+	virtual void write(std::span<const float> samples) = 0;
+
+	// finishes the output, called once after the last write
+	virtual void close() {}
+};
+
+
+// Discards everything, used for testing and measuring the simulation speed.
+class NullSink : public AudioSink {
+public:
+	void write([[maybe_unused]] std::span<const float> samples) override {}
+};
+
+
+// Headerless little-endian 32-bit float PCM.
+class RawSink : public AudioSink {
+private:
+	std::ofstream file;
+
+public:
+	explicit RawSink(const fs::path &path);
+
+	void write(std::span<const float> samples) override;
+	void close() override;
+};
+
+
+// 32-bit IEEE float WAV file, the sizes in the header are filled in on close.
+class WavSink : public AudioSink {
+private:
+	std::ofstream file;
+	uint16_t channels;
+	uint32_t samplerate;
+	uint64_t data_bytes;
+
+	void write_header();
+
+public:
+	WavSink(const fs::path &path, size_t channels, scalar samplerate);
+
+	void write(std::span<const float> samples) override;
+	void close() override;
+};
+
+
+// type is one of "null", "raw" and "wav"
+std::unique_ptr<AudioSink> make_sink(std::string_view type, const fs::path &path, size_t channels, scalar samplerate);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+
+// Lock-free single-producer/single-consumer ring buffer.
+// One thread may only push and one other thread may only pop, no other synchronization is needed.
+template <class T>
+class SpscRingBuffer {
+private:
+	// keeps the indices on separate cache lines, so the threads do not fight over them
+	static constexpr size_t cache_line = 64;
+
+	std::vector<T> buffer;
+	size_t mask;
+
+	// both indices only grow, the position in the buffer is index & mask
+	alignas(cache_line) std::atomic<size_t> head; // written by the producer
+	alignas(cache_line) std::atomic<size_t> tail; // written by the consumer
+
+public:
+	// the capacity is rounded up to a power of two
+	explicit SpscRingBuffer(size_t min_capacity) :
+		buffer(std::bit_ceil(min_capacity < 2 ? size_t{ 2 } : min_capacity)),
+		mask(buffer.size() - 1),
+		head(0),
+		tail(0) {
+	}
+
+	SpscRingBuffer(const SpscRingBuffer &) = delete;
+	SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+	size_t capacity() const noexcept { return buffer.size(); }
+
+	// exact when called from the consumer or the producer thread, otherwise just an estimate
+	size_t size() const noexcept {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	size_t free_space() const noexcept { return capacity() - size(); }
+
+	// producer only, pushes as many items as fit and returns their count
+	size_t push(std::span<const T> items) noexcept {
+		const size_t h = head.load(std::memory_order_relaxed);
+		const size_t t = tail.load(std::memory_order_acquire);
+
+		size_t count = std::min(items.size(), capacity() - (h - t));
+		for (size_t i = 0; i < count; ++i) {
+			buffer[(h + i) & mask] = items[i];
+		}
+
+		head.store(h + count, std::memory_order_release);
+		return count;
+	}
+
+	// producer only
+	bool try_push(T item) noexcept {
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == capacity()) return false;
+
+		buffer[h & mask] = std::move(item);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only, pops as many items as available and returns their count
+	size_t pop(std::span<T> out) noexcept {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		const size_t h = head.load(std::memory_order_acquire);
+
+		size_t count = std::min(out.size(), h - t);
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = std::move(buffer[(t + i) & mask]);
+		}
+
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	// consumer only
+	bool try_pop(T &item) noexcept {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (head.load(std::memory_order_acquire) == t) return false;
+
+		item = std::move(buffer[t & mask]);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+};
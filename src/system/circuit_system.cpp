@@ -0,0 +1,360 @@
+#include "system/circuit_system.h"
+
+#include "circuit/circuit.h"
+#include "circuit/interpreter/interpreter.h"
+#include "circuit/scalar.h"
+#include "stream/spsc_ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// every connection queue holds this many blocks, one of them is the initial latency
+static constexpr size_t connection_queue_blocks = 4;
+
+
+CircuitSystem::CircuitSystem(scalar timestep, size_t block_size, const fs::path &tables_path) :
+	timestep(timestep),
+	block_size(block_size),
+	tables_path(tables_path),
+	adaptive(false),
+	method(IntegrationMethod::BackwardEuler),
+	oversampling(1),
+	operating_point(false),
+	table_chunk_size(0),
+	table_format(TableFormat::Csv) {
+	if (block_size == 0) throw std::invalid_argument("The block size must be positive.");
+}
+
+size_t CircuitSystem::find_module(const std::string &name) const {
+	for (size_t i = 0; i < modules.size(); ++i) {
+		if (modules[i].name == name) return i;
+	}
+	throw std::out_of_range(std::format("The system does not have module '{}'.", name));
+}
+
+Circuit &CircuitSystem::add_module(const std::string &name, const fs::path &circuit_path) {
+	for (const auto &module : modules) {
+		if (module.name == name) throw std::runtime_error(std::format("Redefinition of module '{}'.", name));
+	}
+
+	auto circuit = std::make_unique<Circuit>(timestep, tables_path / name);
+	circuit->load_circuit(circuit_path);
+	circuit->set_adaptive(adaptive, adaptive_settings);
+	circuit->set_integration_method(method);
+	circuit->set_oversampling(oversampling);
+	circuit->set_start_from_operating_point(operating_point);
+	circuit->set_scope_decimation(scope_decimation);
+	circuit->set_table_streaming(table_chunk_size);
+	circuit->set_table_format(table_format);
+
+	Module module{
+		.name = name,
+		.circuit = std::move(circuit),
+		.input_connections = {},
+		.output_connections = {},
+	};
+	module.input_connections.assign(module.circuit->input_count(), nullptr);
+	module.output_connections.resize(module.circuit->output_count());
+
+	modules.push_back(std::move(module));
+	return *modules.back().circuit;
+}
+
+void CircuitSystem::set_adaptive(bool enabled, const AdaptiveSettings &settings) {
+	adaptive = enabled;
+	adaptive_settings = settings;
+
+	for (auto &module : modules) {
+		module.circuit->set_adaptive(adaptive, adaptive_settings);
+	}
+}
+
+void CircuitSystem::set_integration_method(IntegrationMethod m) {
+	method = m;
+
+	for (auto &module : modules) {
+		module.circuit->set_integration_method(method);
+	}
+}
+
+void CircuitSystem::set_oversampling(size_t factor) {
+	oversampling = factor;
+
+	for (auto &module : modules) {
+		module.circuit->set_oversampling(oversampling);
+	}
+}
+
+void CircuitSystem::set_scope_decimation(const Scope::Decimation &decimation) {
+	scope_decimation = decimation;
+
+	for (auto &module : modules) {
+		module.circuit->set_scope_decimation(scope_decimation);
+	}
+}
+
+void CircuitSystem::set_table_streaming(size_t chunk_size) {
+	table_chunk_size = chunk_size;
+
+	for (auto &module : modules) {
+		module.circuit->set_table_streaming(table_chunk_size);
+	}
+}
+
+void CircuitSystem::set_table_format(TableFormat format) {
+	table_format = format;
+
+	for (auto &module : modules) {
+		module.circuit->set_table_format(table_format);
+	}
+}
+
+void CircuitSystem::set_start_from_operating_point(bool enabled) {
+	operating_point = enabled;
+
+	for (auto &module : modules) {
+		module.circuit->set_start_from_operating_point(operating_point);
+	}
+}
+
+void CircuitSystem::connect(const std::string &from_module, const std::string &output_name, const std::string &to_module, const std::string &input_name) {
+	size_t from = find_module(from_module);
+	size_t to = find_module(to_module);
+
+	size_t output_id = modules[from].circuit->get_output_id(output_name);
+	size_t input_id = modules[to].circuit->get_input_id(input_name);
+
+	if (modules[to].input_connections[input_id] != nullptr) {
+		throw std::runtime_error(std::format("Input {}.{} is already connected.", to_module, input_name));
+	}
+
+	auto connection = std::make_unique<Connection>(Connection{
+		.from_module = from,
+		.output_id = output_id,
+		.to_module = to,
+		.input_id = input_id,
+		.queue = std::make_unique<SpscRingBuffer<scalar>>(connection_queue_blocks * block_size),
+	});
+
+	modules[to].input_connections[input_id] = connection.get();
+	modules[from].output_connections[output_id].push_back(connection.get());
+
+	connections.push_back(std::move(connection));
+}
+
+
+static std::string_view trim(std::string_view s) {
+	while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+	while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+	return s;
+}
+
+// splits "module.port" into its two halves
+static std::pair<std::string, std::string> split_port(std::string_view port, size_t line_idx) {
+	size_t dot = port.find('.');
+	if (dot == std::string_view::npos || dot == 0 || dot == port.size() - 1) {
+		throw ParseError(std::format("Name error on line {}: Invalid port name '{}', expected '<module>.<port>'.", line_idx, port));
+	}
+	return { std::string(port.substr(0, dot)), std::string(port.substr(dot + 1)) };
+}
+
+void CircuitSystem::execute_line(std::string_view line, size_t line_idx, const fs::path &base_dir) {
+	if (auto comment = line.find("//"); comment != std::string_view::npos) {
+		line = line.substr(0, comment);
+	}
+	line = trim(line);
+	if (line.empty()) return;
+
+	if (line.starts_with("module ")) {
+		// module <name>: <path>, the path is the rest of the line so it may contain spaces
+		auto rest = line.substr(7);
+		size_t colon = rest.find(':');
+		if (colon == std::string_view::npos) {
+			throw ParseError(std::format("Syntax error on line {}: Expected 'module <name>: <path>'.", line_idx));
+		}
+
+		std::string name(trim(rest.substr(0, colon)));
+		fs::path path(std::string(trim(rest.substr(colon + 1))));
+
+		if (name.empty() || path.empty()) {
+			throw ParseError(std::format("Syntax error on line {}: Expected 'module <name>: <path>'.", line_idx));
+		}
+		if (path.is_relative()) path = base_dir / path;
+
+		try {
+			add_module(name, path);
+		}
+		catch (const std::exception &e) {
+			throw ParseError(std::format("Error in module {} on line {}: {}", name, line_idx, e.what()));
+		}
+	}
+	else if (line.starts_with("connect ")) {
+		// connect <module>.<output> to <module>.<input>
+		std::vector<std::string_view> tokens;
+		auto rest = line.substr(8);
+		while (!(rest = trim(rest)).empty()) {
+			size_t end = 0;
+			while (end < rest.size() && !std::isspace(static_cast<unsigned char>(rest[end]))) ++end;
+			tokens.push_back(rest.substr(0, end));
+			rest.remove_prefix(end);
+		}
+
+		if (tokens.size() != 3 || tokens[1] != "to") {
+			throw ParseError(std::format("Syntax error on line {}: Expected 'connect <module>.<output> to <module>.<input>'.", line_idx));
+		}
+
+		auto [from_module, output_name] = split_port(tokens[0], line_idx);
+		auto [to_module, input_name] = split_port(tokens[2], line_idx);
+
+		try {
+			connect(from_module, output_name, to_module, input_name);
+		}
+		catch (const std::exception &e) {
+			throw ParseError(std::format("Error on line {}: {}", line_idx, e.what()));
+		}
+	}
+	else {
+		throw ParseError(std::format("Syntax error on line {}: Expected 'module' or 'connect', got '{}'.", line_idx, line));
+	}
+}
+
+void CircuitSystem::load_patch(const fs::path &patch_path) {
+	std::cout << "Loading patch " << patch_path << std::endl;
+
+	std::ifstream f(patch_path);
+	if (!f) {
+		throw std::runtime_error("Cannot open patch file: " + patch_path.string());
+	}
+
+	std::string line;
+	size_t line_idx = 0;
+	while (std::getline(f, line)) {
+		execute_line(line, ++line_idx, patch_path.parent_path());
+	}
+
+	std::cout << "Loaded patch with " << modules.size() << " modules and " << connections.size() << " connections" << std::endl;
+}
+
+
+void CircuitSystem::run_module(Module &module, size_t num_steps, std::atomic<bool> &failed) {
+	Circuit &circuit = *module.circuit;
+
+	// unconnected inputs are held at zero
+	std::vector<std::vector<scalar>> input_buffers(circuit.input_count(), std::vector<scalar>(block_size, 0.0));
+	std::vector<std::vector<scalar>> output_buffers(circuit.output_count(), std::vector<scalar>(block_size, 0.0));
+
+	std::vector<std::span<const scalar>> inputs(input_buffers.begin(), input_buffers.end());
+	std::vector<std::span<scalar>> outputs(output_buffers.begin(), output_buffers.end());
+
+	for (size_t done = 0; done < num_steps;) {
+		const size_t n = std::min(block_size, num_steps - done);
+
+		for (size_t i = 0; i < module.input_connections.size(); ++i) {
+			Connection *connection = module.input_connections[i];
+			if (!connection) continue;
+
+			std::span<scalar> pending(input_buffers[i].data(), n);
+			while (!pending.empty()) {
+				pending = pending.subspan(connection->queue->pop(pending));
+				if (pending.empty()) break;
+				if (failed) return;
+				std::this_thread::yield();
+			}
+		}
+
+		circuit.process_block(n, inputs, outputs, true);
+
+		for (size_t i = 0; i < module.output_connections.size(); ++i) {
+			for (Connection *connection : module.output_connections[i]) {
+				std::span<const scalar> pending(output_buffers[i].data(), n);
+				while (!pending.empty()) {
+					pending = pending.subspan(connection->queue->push(pending));
+					if (pending.empty()) break;
+					if (failed) return;
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		done += n;
+	}
+}
+
+void CircuitSystem::run_for_steps(size_t num_steps) {
+	if (modules.empty()) {
+		throw std::runtime_error("Error: Empty system, not running.");
+	}
+
+	for (auto &module : modules) {
+		module.circuit->prepare();
+	}
+
+	// one block of latency on every connection, the consumer reads it while the producer computes its first block
+	std::vector<scalar> silence(block_size, 0.0);
+	for (auto &connection : connections) {
+		while (connection->queue->size() != 0) {
+			scalar discard;
+			connection->queue->try_pop(discard);
+		}
+		connection->queue->push(silence);
+	}
+
+	std::cout << "Running " << modules.size() << " modules for " << num_steps << " steps with frequency=" << 1.0_s / timestep << std::endl;
+
+	std::atomic<bool> failed = false;
+	std::vector<std::exception_ptr> errors(modules.size(), nullptr);
+
+	{
+		std::vector<std::jthread> workers;
+		for (size_t i = 0; i < modules.size(); ++i) {
+			workers.emplace_back([&, i] {
+				try {
+					run_module(modules[i], num_steps, failed);
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+					failed = true;
+				}
+			});
+		}
+	}
+
+	for (size_t i = 0; i < modules.size(); ++i) {
+		if (!errors[i]) continue;
+
+		try {
+			std::rethrow_exception(errors[i]);
+		}
+		catch (const std::exception &e) {
+			throw std::runtime_error(std::format("Error in module {}: {}", modules[i].name, e.what()));
+		}
+	}
+}
+
+void CircuitSystem::run_for_seconds(scalar secs) {
+	run_for_steps(static_cast<size_t>(secs / timestep));
+}
+
+void CircuitSystem::export_tables() const {
+	for (const auto &module : modules) {
+		module.circuit->export_tables();
+	}
+}
+
+void CircuitSystem::show_graphs() const {
+	for (const auto &module : modules) {
+		module.circuit->show_graphs();
+	}
+}
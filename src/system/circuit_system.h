@@ -0,0 +1,99 @@
+#pragma once
+
+#include "circuit/circuit.h"
+#include "circuit/scalar.h"
+#include "circuit/scope.h"
+#include "io/table_file.h"
+#include "stream/spsc_ring_buffer.h"
+
+#include <atomic>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// Several circuits (modules) connected through their block processing inputs and outputs.
+// Every module has its own matrix and runs on its own thread, the connections carry the sample blocks
+// through lock-free queues with one block of latency, so the modules only wait for each other
+// at the block boundaries and even feedback loops between modules cannot deadlock.
+class CircuitSystem {
+private:
+	struct Connection {
+		size_t from_module;
+		size_t output_id;
+		size_t to_module;
+		size_t input_id;
+		std::unique_ptr<SpscRingBuffer<scalar>> queue;
+	};
+
+	struct Module {
+		std::string name;
+		std::unique_ptr<Circuit> circuit;
+
+		// input_connections[i] is the connection feeding input i, or nullptr when the input is not connected
+		std::vector<Connection *> input_connections;
+		// output_connections[i] are all connections fed by output i
+		std::vector<std::vector<Connection *>> output_connections;
+	};
+
+	std::vector<Module> modules;
+	std::vector<std::unique_ptr<Connection>> connections;
+
+	scalar timestep;
+	size_t block_size;
+	fs::path tables_path;
+
+	bool adaptive;
+	AdaptiveSettings adaptive_settings;
+	IntegrationMethod method;
+	size_t oversampling;
+	bool operating_point;
+	Scope::Decimation scope_decimation;
+	size_t table_chunk_size;
+	TableFormat table_format;
+
+	size_t find_module(const std::string &name) const;
+
+	void execute_line(std::string_view line, size_t line_idx, const fs::path &base_dir);
+
+	void run_module(Module &module, size_t num_steps, std::atomic<bool> &failed);
+
+public:
+	// every module exports its scope tables into tables_path/<module name>/
+	CircuitSystem(scalar timestep, size_t block_size, const fs::path &tables_path = "./");
+
+	// sets the stepping of all modules, including the ones added later
+	void set_adaptive(bool enabled, const AdaptiveSettings &settings = {});
+	void set_integration_method(IntegrationMethod m);
+	void set_oversampling(size_t factor);
+	void set_start_from_operating_point(bool enabled);
+	// the scopes of the modules without their own decimation
+	void set_scope_decimation(const Scope::Decimation &decimation);
+	// the modules write their scope tables while running, see Circuit::set_table_streaming
+	void set_table_streaming(size_t chunk_size);
+	void set_table_format(TableFormat format);
+
+	// loads the circuit of a new module from a .simlog file
+	Circuit &add_module(const std::string &name, const fs::path &circuit_path);
+
+	// connects an output of one module to an input of another (or the same) module
+	void connect(const std::string &from_module, const std::string &output_name, const std::string &to_module, const std::string &input_name);
+
+	// loads a patch file, see the readme for its syntax, the module paths are relative to the patch file
+	void load_patch(const fs::path &patch_path);
+
+	// runs all modules in parallel, the scopes of the modules are recorded
+	void run_for_steps(size_t num_steps);
+	void run_for_seconds(scalar secs);
+
+	void export_tables() const;
+	void show_graphs() const;
+
+	inline size_t module_count() const noexcept { return modules.size(); }
+	inline Circuit &get_module(size_t id) { return *modules.at(id).circuit; }
+};
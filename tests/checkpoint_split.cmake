@@ -0,0 +1,29 @@
+# Runs the circuit for 0.2s at once and in two parts of 0.1s resumed from a checkpoint,
+# the checkpoints at the end of both runs have to be the same file.
+#   cmake -DSIMLOGUE=<binary> -DCIRCUIT=<simlog> -DWORK_DIR=<dir> -P checkpoint_split.cmake
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+function(run_simlogue)
+    execute_process(
+        COMMAND ${SIMLOGUE} ${CIRCUIT} ${ARGN}
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE result
+        OUTPUT_QUIET
+    )
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "simlogue ${ARGN} failed: ${result}")
+    endif()
+endfunction()
+
+run_simlogue(0.2s --checkpoint ${WORK_DIR}/full.ck)
+run_simlogue(0.1s --checkpoint ${WORK_DIR}/half.ck)
+run_simlogue(0.1s --resume ${WORK_DIR}/half.ck --checkpoint ${WORK_DIR}/split.ck)
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/full.ck ${WORK_DIR}/split.ck
+    RESULT_VARIABLE different
+)
+if (different)
+    message(FATAL_ERROR "The checkpoint of the split run differs from the one of the whole run.")
+endif()
@@ -0,0 +1,167 @@
+// The numerical building blocks the simulation relies on, each test is run by its name:
+// simlogue_tests <lu_plan|lu_plan_checkpoint|fft>
+
+#include "circuit/checkpoint.h"
+#include "dsp/fft.h"
+#include "lingebra/lingebra.h"
+#include "lingebra/lu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+
+static size_t failures = 0;
+
+static void check(bool condition, std::string_view what) {
+	if (condition) return;
+	std::cerr << "FAILED: " << what << "\n";
+	++failures;
+}
+
+
+// a sparse matrix like the one of a circuit: six nodes coupled to their neighbours and the two branch rows
+// of voltage sources, which have no diagonal entry, so the pivots cannot simply be taken from the diagonal
+static lingebra::Matrix<double> circuit_matrix(double scale, std::vector<char> &structure) {
+	constexpr size_t n = 8;
+	lingebra::Matrix<double> a(n, n);
+	structure.assign(n * n, 0);
+
+	const auto set = [&](size_t row, size_t col, double value) {
+		a(row, col) = value;
+		structure[row * n + col] = 1;
+	};
+
+	for (size_t i = 0; i < 6; ++i) {
+		set(i, i, scale * (3.0 + static_cast<double>(i)));
+		if (i + 1 < 6) {
+			set(i, i + 1, -scale);
+			set(i + 1, i, -scale);
+		}
+	}
+	// voltage sources between the nodes 0 and 3 and the node 5 and the ground
+	set(0, 6, 1.0);
+	set(6, 0, 1.0);
+	set(3, 6, -1.0);
+	set(6, 3, -1.0);
+	set(5, 7, 1.0);
+	set(7, 5, 1.0);
+	return a;
+}
+
+static lingebra::Vector<double> multiply(const lingebra::Matrix<double> &a, const lingebra::Vector<double> &x) {
+	lingebra::Vector<double> b(x.dim());
+	for (size_t i = 0; i < a.n(); ++i) {
+		for (size_t j = 0; j < a.n(); ++j) b[i] += a(i, j) * x[j];
+	}
+	return b;
+}
+
+static double solve_error(const lingebra::LUPlan &plan, lingebra::Matrix<double> a) {
+	const size_t n = a.n();
+	lingebra::Vector<double> expected(n);
+	for (size_t i = 0; i < n; ++i) expected[i] = 1.0 + 0.5 * static_cast<double>(i);
+
+	lingebra::Vector<double> b = multiply(a, expected);
+	lingebra::Vector<double> x(n);
+	if (!plan.factorize(a)) return std::numeric_limits<double>::infinity();
+	plan.solve(a, b, x);
+
+	double error = 0.0;
+	for (size_t i = 0; i < n; ++i) error = std::max(error, std::abs(x[i] - expected[i]));
+	return error;
+}
+
+static void test_lu_plan() {
+	std::vector<char> structure;
+	const auto a = circuit_matrix(1.0, structure);
+	const auto plan = lingebra::LUPlan::analyze(a, structure);
+
+	check(plan.dim() == a.n(), "the plan has the size of the matrix");
+	check(solve_error(plan, a) < 1e-12, "the plan solves the matrix it was analyzed from");
+
+	// the plan is reused for other values of the same pattern
+	check(solve_error(plan, circuit_matrix(2.5, structure)) < 1e-12, "the plan solves a matrix with other values");
+}
+
+static void test_lu_plan_checkpoint() {
+	std::vector<char> structure;
+	const auto a = circuit_matrix(1.0, structure);
+	const auto plan = lingebra::LUPlan::analyze(a, structure);
+
+	std::stringstream stream;
+	CheckpointWriter out(stream);
+	plan.save(out);
+
+	CheckpointReader in(stream);
+	const auto loaded = lingebra::LUPlan::load(in);
+
+	check(loaded.dim() == plan.dim(), "the loaded plan has the size of the saved one");
+	check(loaded.get_positions() == plan.get_positions(), "the loaded plan has the pattern of the saved one");
+	check(solve_error(loaded, circuit_matrix(2.5, structure)) < 1e-12, "the loaded plan solves the matrix");
+}
+
+static void test_fft() {
+	constexpr size_t n = 64;
+	const Fft fft(n);
+
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+	std::vector<double> x_re(n), x_im(n);
+	for (size_t i = 0; i < n; ++i) {
+		x_re[i] = distribution(engine);
+		x_im[i] = distribution(engine);
+	}
+
+	std::vector<double> re = x_re, im = x_im;
+	fft.transform(re, im);
+
+	// against the definition of the DFT
+	double error = 0.0;
+	for (size_t k = 0; k < n; ++k) {
+		std::complex<double> sum = 0.0;
+		for (size_t j = 0; j < n; ++j) {
+			const double angle = -2.0 * std::numbers::pi * static_cast<double>(j * k % n) / static_cast<double>(n);
+			sum += std::complex<double>(x_re[j], x_im[j]) * std::polar(1.0, angle);
+		}
+		error = std::max(error, std::abs(sum - std::complex<double>(re[k], im[k])));
+	}
+	check(error < 1e-12, "the fft is the dft");
+
+	// the inverse is the forward transform of the conjugate, conjugated and divided by n
+	for (auto &value : im) value = -value;
+	fft.transform(re, im);
+	error = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		const std::complex<double> back(re[i] / static_cast<double>(n), -im[i] / static_cast<double>(n));
+		error = std::max(error, std::abs(back - std::complex<double>(x_re[i], x_im[i])));
+	}
+	check(error < 1e-14, "the inverse fft gives the signal back");
+}
+
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		std::cerr << "Usage: simlogue_tests <lu_plan|lu_plan_checkpoint|fft>\n";
+		return 2;
+	}
+
+	const std::string_view name = argv[1];
+	if (name == "lu_plan") test_lu_plan();
+	else if (name == "lu_plan_checkpoint") test_lu_plan_checkpoint();
+	else if (name == "fft") test_fft();
+	else {
+		std::cerr << "Unknown test " << name << "\n";
+		return 2;
+	}
+
+	return failures == 0 ? 0 : 1;
+}